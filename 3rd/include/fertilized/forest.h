@@ -592,8 +592,8 @@ namespace fertilized {
      *
      * -----
      */ 
-    tree_ptr_vec_t get_trees() const {
-      return trees;
+    const tree_ptr_vec_t &get_trees() const {
+      return *trees;
     }
     
     /**
@@ -51,7 +51,7 @@ namespace cudax {
 		}
 		
 		__device__
-			void skeleton_jacobian(const int joint_id, const glm::vec3& pos, J_row* sub_J, glm::vec3 nrm = glm::vec3(0), bool project = false) {
+			void skeleton_jacobian(const int joint_id, const glm::vec3& pos, J_row* sub_J, glm::vec3 nrm = glm::vec3(0), bool project = false, SparseRow* sparse_J = NULL) {
 
 			//float j_buffer[CHAIN_MAX_LENGTH];
 			for (int i_column = 0; i_column < CHAIN_MAX_LENGTH; i_column++) {
@@ -74,7 +74,12 @@ namespace cudax {
 				}
 				}
 				
-				if (point_to_plane || project) {
+				if (sparse_J) {
+					sparse_J->index[i_column] = jinfo.index;
+					sparse_J->value[i_column] = weight * glm::dot(col, nrm);
+					sparse_J->size = i_column + 1;
+				}
+				else if (point_to_plane || project) {
 					sub_J->data[jinfo.index] = weight * glm::dot(col, nrm);					
 
 					///					
@@ -131,6 +136,16 @@ namespace cudax {
 				float w = rsqrt(d + 1e-3);
 				if (d > 1e-3) weight *= w * 3.5f; // factor 3.5 compensates for residual magnitude change
 			}
+			///--- Streamed rows are sparse and always point to plane
+			if (accumulators) {
+				SparseRow J_sparse;
+				J_sparse.size = 0;
+				float e = weight * glm::dot(p - q, n);
+				skeleton_jacobian(joint_id, p, NULL, n, true, &J_sparse);
+				accumulate(constraint_index, &J_sparse, &e, 1, false);
+				return;
+			}
+
 			///--- Access to a 3xN block of Jacobian
 			J_row* J_sub = J_raw + constraint_index;
 			float* e_sub = e_raw + constraint_index;
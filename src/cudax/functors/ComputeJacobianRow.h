@@ -12,10 +12,12 @@ protected:
     int2* cnstr_indexes; ///< raw
     CustomJointInfo* jointinfos; ///< raw
     ChainElement* chains; ///< raw
+    float* accumulators; ///< raw, NULL unless rows are streamed (see settings->fit_streaming)
 public:
     ComputeJacobianRow(J_row* J_raw, float* e_raw){
-        assert(J_raw!=NULL);
-        assert(e_raw!=NULL);        
+        this->accumulators = settings->fit_streaming ? thrust::raw_pointer_cast(cudax::accumulators->data()) : NULL;
+        assert(accumulators!=NULL || J_raw!=NULL);
+        assert(accumulators!=NULL || e_raw!=NULL);
         this->J_raw = J_raw;
         this->e_raw = e_raw;
         this->cnstr_indexes = ::pixel_indexer->cnstr_indexes;
@@ -23,6 +25,28 @@ public:
         this->chains = ::kinematic->chains;
     }
 
+protected:
+    /// Adds J_sub^T*J_sub and J_sub^T*e_sub to one of the accumulators
+    /// @note only JtJ[min(i,j)*NUM_THETAS + max(i,j)] is written, kernel() fills the other half
+    __device__
+    void accumulate(int constraint_index, const SparseRow* J_sub, const float* e_sub, int num_rows, bool push){
+        float* JtJ = accumulators + (constraint_index % NUM_ACCUMULATORS) * ACCUMULATOR_SIZE;
+        float* JtF = JtJ + NUM_THETAS * NUM_THETAS;
+        float* error = JtF + NUM_THETAS + (push ? 0 : 1);
+        for (int r = 0; r < num_rows; r++) {
+            const SparseRow& row = J_sub[r];
+            for (int a = 0; a < row.size; a++) {
+                int i = row.index[a];
+                atomicAdd(JtF + i, row.value[a] * e_sub[r]);
+                for (int b = a; b < row.size; b++) {
+                    int j = row.index[b];
+                    atomicAdd(JtJ + min(i, j) * NUM_THETAS + max(i, j), row.value[a] * row.value[b]);
+                }
+            }
+            atomicAdd(error, fabsf(e_sub[r]));
+        }
+    }
+
 protected:    
     __device__
     glm::mat3x2 projection_jacobian(const glm::vec3& pos){
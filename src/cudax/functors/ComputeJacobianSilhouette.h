@@ -25,10 +25,30 @@ public:
 		this->rendered_block_ids = thrust::raw_pointer_cast(_rendered_block_ids->data());
     }
         
+	/// Writes the two entries of column i_column, either in the dense rows J_sub or in the sparse rows J_sparse
+	__device__
+		void set_column(J_row* J_sub, SparseRow* J_sparse, int i_column, int index, glm::vec2 jcol) {
+		if (J_sparse) {
+			J_sparse[0].index[i_column] = J_sparse[1].index[i_column] = index;
+			J_sparse[0].value[i_column] = jcol.x;
+			J_sparse[1].value[i_column] = jcol.y;
+			J_sparse[0].size = J_sparse[1].size = i_column + 1;
+		}
+		else {
+			(J_sub + 0)->data[index] = jcol.x;
+			(J_sub + 1)->data[index] = jcol.y;
+		}
+	}
+
 	__device__
 		void assemble_linear_system(int constraint_index, int b, glm::vec2 p_diff, glm::vec3 p_rend_3D) {
-		J_row* J_sub = J_raw + 2 * constraint_index;
-		float* e_sub = e_raw + 2 * constraint_index;
+		///--- Streamed rows are sparse (see ComputeJacobianRow::accumulate)
+		SparseRow J_local[2];
+		J_local[0].size = J_local[1].size = 0;
+		float e_local[2];
+		SparseRow* J_sparse = accumulators ? J_local : NULL;
+		J_row* J_sub = accumulators ? NULL : J_raw + 2 * constraint_index;
+		float* e_sub = accumulators ? e_local : e_raw + 2 * constraint_index;
 
 		int joint_id;
 		if (_htrack_device) joint_id = b;
@@ -62,8 +82,7 @@ public:
 			{
 				glm::vec3 col = glm::vec3(jointinfos[jointinfo_id].mat * glm::vec4(axis, 1));
 				glm::vec2 jcol = J_proj * col;
-				(J_sub + 0)->data[jinfo.index] = weight * jcol.x;
-				(J_sub + 1)->data[jinfo.index] = weight * jcol.y;
+				set_column(J_sub, J_sparse, i_column, jinfo.index, weight * jcol);
 
 				/*if (off.z == 52962) {
 				printf("\nindex = %d\n", jinfo.index);
@@ -85,8 +104,7 @@ public:
 				glm::vec3 a = glm::normalize(glm::vec3(jointinfos[jointinfo_id].mat * glm::vec4(axis, 1)) - t);
 				glm::vec3 col = glm::cross(a, p_rend_3D - t);
 				glm::vec2 jcol = J_proj * col;
-				(J_sub + 0)->data[jinfo.index] = weight * jcol.x;
-				(J_sub + 1)->data[jinfo.index] = weight * jcol.y;
+				set_column(J_sub, J_sparse, i_column, jinfo.index, weight * jcol);
 
 				/*if (off.z == 52962) {
 				printf("\nindex = %d\n", jinfo.index);
@@ -109,6 +127,8 @@ public:
 		/// Fills RHS
 		*(e_sub + 0) = weight * p_diff.x;
 		*(e_sub + 1) = weight * p_diff.y;
+
+		if (accumulators) accumulate(constraint_index, J_sparse, e_sub, 2, true);
 	}
 
 public:
@@ -3,6 +3,7 @@
 #include <thrust/host_vector.h>
 #include <thrust/copy.h>
 #include <thrust/sequence.h>
+#include <thrust/transform_reduce.h>
 
 #include "cudax/kernel.h"
 #include "cudax/CudaTimer.h"
@@ -48,6 +49,7 @@ void kernel(float* eigen_JtJ, float* eigen_JtF, float & push_error, float & pull
     // CUDA_TIMED_BLOCK(timer,"indexing constraints")
 
 	int n_pull, n_push;
+	if (eval_metric) push_error = pull_error = 0; ///< also the errors of a term without constraints
 
 	if (settings->fit2D_enable) {
 		n_push = 2 * num_rendered_points;
@@ -63,9 +65,43 @@ void kernel(float* eigen_JtJ, float* eigen_JtF, float & push_error, float & pull
 	}
 
 	int n_total = n_pull + n_push;	
+	thrust::sequence(push_indices->begin(), push_indices->begin() + num_rendered_points);
+
+	///--- Streaming: rows are accumulated straight into JtJ/JtF, J and F are never touched
+	if (settings->fit_streaming) {
+		if (n_total == 0) return;
+		thrust::fill(accumulators->begin(), accumulators->end(), 0.0f);
+
+		ComputeJacobianSilhouette functor_push(NULL, NULL);
+		ComputeJacobianData functor_data_model(NULL, NULL, reweight);
+		if (settings->fit2D_enable)
+			thrust::for_each(push_indices->begin(), push_indices->begin() + num_rendered_points, functor_push);
+		if (settings->fit3D_enable)
+			thrust::for_each(_sensor_indicator->begin(), _sensor_indicator->begin() + num_sensor_points, functor_data_model);
+
+		// Final reduction (sum of the rows of the accumulators matrix)
+		CublasHelper::vector_product(*accumulators, *accumulators_ones, *accumulators_sum, NUM_ACCUMULATORS, ACCUMULATOR_SIZE);
+		thrust::host_vector<float> sum = *accumulators_sum;
+		for (int i = 0; i < NUM_THETAS; i++)
+			for (int j = i + 1; j < NUM_THETAS; j++)
+				sum[j * NUM_THETAS + i] = sum[i * NUM_THETAS + j]; ///< only one half was accumulated
+		std::copy(sum.begin(), sum.begin() + NUM_THETAS * NUM_THETAS, eigen_JtJ);
+		std::copy(sum.begin() + NUM_THETAS * NUM_THETAS, sum.begin() + NUM_THETAS * NUM_THETAS + NUM_THETAS, eigen_JtF);
+
+		/// Only need evaluate metric on the last iteration
+		if (eval_metric) {
+			if (n_push > 0) push_error = sum[NUM_THETAS * NUM_THETAS + NUM_THETAS] / n_push;
+			if (n_pull > 0) pull_error = sum[NUM_THETAS * NUM_THETAS + NUM_THETAS + 1] / n_pull;
+		}
+		return;
+	}
       
     // CUDA_TIMED_BLOCK(timer,"memory resize + zero (J+e)")
     { 
+        if (J->size() < n_total) {
+            J->resize(n_total);
+            F->resize(n_total);
+        }
         const J_row zeros = {};
 		thrust::fill(J->begin(), J->begin() + n_total, zeros);
 		thrust::fill(F->begin(), F->begin() + n_total, 0.0f);
@@ -87,8 +123,6 @@ void kernel(float* eigen_JtJ, float* eigen_JtF, float & push_error, float & pull
 		functor_data_model.store_data(thrust::raw_pointer_cast(hmodel_correspondences->data()));
     }
     
-	thrust::sequence(push_indices->begin(), push_indices->begin() + num_rendered_points);
-
     //CUDA_TIMED_BLOCK(timer,"Assemble Jacobian")
 	{
 		if (settings->fit2D_enable) {
@@ -136,16 +170,12 @@ void kernel(float* eigen_JtJ, float* eigen_JtF, float & push_error, float & pull
 
     /// Only need evaluate metric on the last iteration
     if (eval_metric) {
-		thrust::device_vector<float> f_pull(n_pull);
-		thrust::transform(F->begin() + n_push, F->begin() + n_push + n_pull, f_pull.begin(), absolute_value());
-		pull_error = thrust::reduce(f_pull.begin(), f_pull.end());
-		pull_error = pull_error / n_pull;
+		pull_error = thrust::transform_reduce(F->begin() + n_push, F->begin() + n_push + n_pull, absolute_value(), 0.0f, thrust::plus<float>());
+		pull_error = n_pull > 0 ? pull_error / n_pull : 0;
 		//std::cout << pull_error << std::endl;
 
-		thrust::device_vector<float> f_push(n_push);
-		thrust::transform(F->begin(), F->begin() + n_push, f_push.begin(), absolute_value());
-		push_error = thrust::reduce(f_push.begin(), f_push.end());
-		push_error = push_error / n_push;
+		push_error = thrust::transform_reduce(F->begin(), F->begin() + n_push, absolute_value(), 0.0f, thrust::plus<float>());
+		push_error = n_push > 0 ? push_error / n_push : 0;
 	}		
 	
 	//Write the correspondences	
@@ -78,6 +78,13 @@ thrust::device_vector<float>* F = NULL; ///< effectors (same # columns as J)
 thrust::device_vector<float>* JtJ = NULL; ///< preallocated memory NUM_THETAS^2
 thrust::device_vector<float>* JtF = NULL; ///< preallocated memory NUM_THETAS
 
+///--- Streaming assembly (settings->fit_streaming), each accumulator is [JtJ | JtF | push_error | pull_error]
+#define NUM_ACCUMULATORS 64 ///< constraints are spread over these to limit atomic contention
+#define ACCUMULATOR_SIZE (NUM_THETAS * NUM_THETAS + NUM_THETAS + 2)
+thrust::device_vector<float>* accumulators = NULL; ///< NUM_ACCUMULATORS x ACCUMULATOR_SIZE (row major)
+thrust::device_vector<float>* accumulators_ones = NULL; ///< NUM_ACCUMULATORS, to sum the accumulators with cublas
+thrust::device_vector<float>* accumulators_sum = NULL; ///< ACCUMULATOR_SIZE
+
 uchar* opencv_image = NULL;
 
 thrust::device_vector<int2>* indexes_memory = NULL; ///< pixel to constraint type + index
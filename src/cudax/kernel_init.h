@@ -26,8 +26,10 @@ void kernel_init(energy::fitting::Settings* _settings, int H_width, int H_height
         //J->reserve(upper_bound_num_constraints);
         //e->reserve(upper_bound_num_constraints);
 		int upper_bound_num_sensor_points = 80000;
-		J->resize(upper_bound_num_sensor_points);
-		F->resize(upper_bound_num_sensor_points);
+		if (!settings->fit_streaming) {
+			J->resize(upper_bound_num_sensor_points);
+			F->resize(upper_bound_num_sensor_points);
+		}
 
 		_sensor_indicator = new thrust::device_vector<int>();
 		_sensor_indicator->resize(upper_bound_num_sensor_points);
@@ -41,6 +43,10 @@ void kernel_init(energy::fitting::Settings* _settings, int H_width, int H_height
         JtJ = new thrust::device_vector<float>(thetas_size*thetas_size);
         JtF = new thrust::device_vector<float>(thetas_size);
 
+        accumulators = new thrust::device_vector<float>(NUM_ACCUMULATORS * ACCUMULATOR_SIZE);
+        accumulators_ones = new thrust::device_vector<float>(NUM_ACCUMULATORS, 1.0f);
+        accumulators_sum = new thrust::device_vector<float>(ACCUMULATOR_SIZE);
+
         kinematic = new Kinematic();
 
         silhouette_sensor = new thrust::device_vector<uchar>(H_width*H_height);
@@ -95,6 +101,9 @@ void kernel_cleanup(){
     delete F;
     delete JtJ;
     delete JtF;
+    delete accumulators;
+    delete accumulators_ones;
+    delete accumulators_sum;
 
 	delete kinematic;
 	delete indexes_memory;
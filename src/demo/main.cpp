@@ -14,6 +14,7 @@
 
 #include "tracker/Tracker.h"
 #include "tracker/GLWidget.h"
+#include "tracker/HModel/Model.h"
 
 
 int main(int argc, char* argv[]) {
@@ -24,6 +25,7 @@ int main(int argc, char* argv[]) {
 
 	bool benchmark = true;
 	bool playback = false;
+	bool convert_model = false; ///< only writes the model bundle from the text model and the pose prior, then exits
 	int user_name = 0;
 
 	int devID = 0;
@@ -34,6 +36,12 @@ int main(int argc, char* argv[]) {
 	std::string data_path = "F:/HandPose_Depth/tpHModel/src/data/";
 	std::string sequence_name = "teaser";
 
+	if (convert_model) {
+		Model model;
+		model.init(user_name, data_path);
+		return model.convert_text_model() ? 0 : 1;
+	}
+
 	Q_INIT_RESOURCE(shaders);
 	QApplication app(argc, argv);
 
@@ -0,0 +1,229 @@
+#include "FlatForest.h"
+#include "fertilized/fertilized.h"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <stdexcept>
+
+namespace {
+typedef FlatForest::Forest::tree_t Tree;
+typedef fertilized::ThresholdDecider<float, float, fertilized::uint> Decider;
+typedef fertilized::ClassificationLeafManager<float, fertilized::uint> LeafManager;
+
+const int limit = 1 << 20; ///< beyond any difference of 16 bit depths
+
+/// Largest integer feature f with f < threshold
+int quantize_below(float threshold) {
+	if (!(threshold > -limit)) return -limit - 1; ///< also NaN, never true
+	if (threshold > limit) return limit;
+	return (int)std::ceil(threshold) - 1;
+}
+
+/// Smallest integer feature f with f > threshold
+int quantize_above(float threshold) {
+	if (!(threshold < limit)) return limit + 1; ///< also NaN, never true
+	if (threshold < -limit) return -limit;
+	return (int)std::floor(threshold) + 1;
+}
+
+/// Leaf that predict_leaf reaches on data, with the decisions on path forced through the parameter hook of
+/// ThresholdDecider::decide and the ones below it true. If the node at the end of path splits, its parameters are
+/// copied to decision, and with check it decides whether its feature is *check instead.
+/// @param depth number of decisions taken, path.size() iff the node at the end of path is a leaf
+fertilized::node_id_t walk(const Tree & tree, const std::vector<float> & data, const std::vector<bool> & path,
+	size_t & depth, Decider::decision_tuple_t * decision = NULL, const float * check = NULL) {
+	const float infinity = std::numeric_limits<float>::infinity();
+	depth = 0;
+	auto force = [&](void * parameters) {
+		Decider::decision_tuple_t & current = *static_cast<Decider::decision_tuple_t *>(parameters);
+		bool end = depth == path.size();
+		if (end && decision) *decision = current;
+		if (end && check) {
+			std::get<2>(current) = fertilized::EThresholdSelection::both;
+			std::get<3>(current) = std::make_pair(*check + 0.5f, *check - 0.5f);
+		} else {
+			std::get<2>(current) = fertilized::EThresholdSelection::less_only;
+			std::get<3>(current).first = depth >= path.size() || path[depth] ? infinity : -infinity;
+		}
+		depth++;
+	};
+	return tree.predict_leaf(data.data(), 1, 0, force);
+}
+
+/// Whether the root computes the feature on data, it then takes the same branch as with the decision forced true
+bool root_feature_is(const Tree & tree, const std::vector<float> & data, float feature) {
+	size_t depth;
+	std::vector<bool> root;
+	return walk(tree, data, root, depth, NULL, &feature) == walk(tree, data, root, depth);
+}
+
+/// Appends the nodes of the tree breadth first, the leaf distributions multiplied by the weight of the tree.
+/// The tree is only read through the public interface of fertilized: the structure and the decisions by walking
+/// it, the feature calculator (the same for every node) by the features it computes at the root.
+bool flatten(const Tree & tree, std::vector<FlatForest::Node> & nodes, std::vector<float> & leaves, int & num_classes) {
+	const Decider * decider = dynamic_cast<const Decider *>(tree.get_decider().get());
+	const LeafManager * leaf_manager = dynamic_cast<const LeafManager *>(tree.get_leaf_manager().get());
+	if (!decider || !leaf_manager || tree.get_n_nodes() == 0) return false;
+	std::vector<float> ones(tree.get_input_data_dimensions(), 1.0f);
+	std::vector<float> ramp(ones.size());
+	for (size_t k = 0; k < ramp.size(); k++) ramp[k] = (float)(k + 1);
+
+	///--- An aligned feature is the data element itself, a difference one the second element minus the first
+	size_t depth;
+	Decider::decision_tuple_t root;
+	walk(tree, ones, std::vector<bool>(), depth, &root);
+	const std::vector<size_t> & selected = std::get<0>(root);
+	bool aligned = false, difference = false;
+	if (depth > 0 && selected.size() >= 1)
+		aligned = root_feature_is(tree, ones, 1) && root_feature_is(tree, ramp, ramp[selected[0]]);
+	if (depth > 0 && selected.size() >= 2)
+		difference = root_feature_is(tree, ones, 0) && root_feature_is(tree, ramp, ramp[selected[1]] - ramp[selected[0]]);
+	if (depth > 0 && !(aligned || difference)) return false;
+
+	if (num_classes == 0) num_classes = leaf_manager->get_n_classes();
+	if (num_classes != (int)leaf_manager->get_n_classes()) return false;
+	float weight = tree.get_weight();
+
+	std::vector<std::vector<bool>> order(1); ///< paths from the root (true to the first child), in the order of the flat tree
+	int first = (int)nodes.size();
+	for (size_t i = 0; i < order.size(); i++) {
+		if (order.size() > tree.get_n_nodes()) return false;
+		std::vector<bool> path = order[i];
+		Decider::decision_tuple_t decision;
+		fertilized::node_id_t leaf = walk(tree, ones, path, depth, &decision);
+		FlatForest::Node node = {};
+
+		///--- Leaf
+		if (depth == path.size()) {
+			std::vector<float> distribution = leaf_manager->get_result(leaf, ones.data());
+			if ((int)distribution.size() != num_classes) return false;
+			node.next = ~(int)(leaves.size() / num_classes);
+			for (float probability : distribution) leaves.push_back(probability * weight);
+			nodes.push_back(node);
+			continue;
+		}
+
+		///--- Split, an aligned feature is the difference with the pixel itself
+		const std::vector<size_t> & selection = std::get<0>(decision);
+		if (selection.size() < (aligned ? 1u : 2u)) return false;
+		size_t a = aligned ? FlatForest::center : selection[0];
+		size_t b = aligned ? selection[0] : selection[1];
+		if (a >= FlatForest::num_offsets || b >= FlatForest::num_offsets) return false;
+		node.ka = a / FlatForest::side; node.la = a % FlatForest::side;
+		node.kb = b / FlatForest::side; node.lb = b % FlatForest::side;
+
+		///--- Same decisions as ThresholdDecider::decide, exact since the features are integers
+		const std::pair<float, float> & thresholds = std::get<3>(decision);
+		node.lo = std::numeric_limits<int>::min();
+		node.hi = std::numeric_limits<int>::max();
+		switch (std::get<2>(decision)) {
+		case fertilized::EThresholdSelection::less_only: node.hi = quantize_below(thresholds.first); break;
+		case fertilized::EThresholdSelection::greater_only: node.lo = quantize_above(thresholds.second); break;
+		case fertilized::EThresholdSelection::both:
+			node.hi = quantize_below(thresholds.first);
+			node.lo = quantize_above(thresholds.second);
+			break;
+		default: return false;
+		}
+
+		node.next = first + (int)order.size();
+		path.push_back(true); ///< taken if the decision is true
+		order.push_back(path);
+		path.back() = false;
+		order.push_back(path);
+		nodes.push_back(node);
+	}
+	return true;
+}
+
+/// Image coordinates of the offsets of one pixel
+struct Offsets {
+	int x[FlatForest::side];
+	int y[FlatForest::side];
+};
+}
+
+bool FlatForest::init(const Forest & forest, double delta, int background) {
+	this->delta = delta;
+	this->background = background;
+	nodes.clear();
+	roots.clear();
+	leaves.clear();
+	num_classes = 0;
+	weight_sum = 0;
+
+	for (const auto & tree : forest.get_trees()) {
+		roots.push_back((int)nodes.size());
+		bool flattened = false;
+		try {
+			flattened = tree && flatten(*tree, nodes, leaves, num_classes);
+		}
+		catch (const std::exception &) {} ///< decide throws for a split without parameters
+		if (!flattened) {
+			nodes.clear();
+			roots.clear();
+			leaves.clear();
+			num_classes = 0;
+			return false;
+		}
+		weight_sum += tree->get_weight(); ///< same order as Forest::predict
+	}
+	return !roots.empty();
+}
+
+void FlatForest::predict(const cv::Mat & depth, const std::vector<cv::Point> & locations, std::vector<float> & probabilities) const {
+	probabilities.assign(locations.size() * num_classes, 0);
+	if (empty()) return;
+
+	const ushort * data = depth.ptr<ushort>();
+	const int width = depth.cols;
+	const int height = depth.rows;
+	const size_t stride = depth.step1();
+	const size_t size = stride * height;
+	double fractions[side];
+	for (int k = 0; k < side; k++) fractions[k] = (k - radius) / (double)radius;
+
+	/// Same bounds as the features of hand_segmentation (the column past the last one reads into the next row),
+	/// reads past the image are background
+	auto read = [&](const Offsets & offsets, int k, int l) -> int {
+		int x = offsets.x[k], y = offsets.y[l];
+		if (x < 0 || x > width || y < 0 || y > height) return background;
+		size_t index = y * stride + x;
+		return index < size ? (int)data[index] : background;
+	};
+
+	int num_locations = (int)locations.size();
+	int num_batches = (num_locations + batch_size - 1) / batch_size;
+	#pragma omp parallel for schedule(dynamic)
+	for (int batch = 0; batch < num_batches; batch++) {
+		int begin = batch * batch_size;
+		int count = std::min((int)batch_size, num_locations - begin);
+		Offsets offsets[batch_size];
+		for (int i = 0; i < count; i++) {
+			const cv::Point & location = locations[begin + i];
+			float d = (float)depth.at<ushort>(location);
+			int step = (int)(delta / d);
+			for (int k = 0; k < side; k++) {
+				offsets[i].x[k] = (int)(location.x + step * fractions[k]);
+				offsets[i].y[k] = (int)(location.y + step * fractions[k]);
+			}
+		}
+
+		///--- Tree by tree over the batch, so that the top of the tree stays in cache
+		float * result = &probabilities[begin * num_classes];
+		for (size_t t = 0; t < roots.size(); t++) {
+			for (int i = 0; i < count; i++) {
+				int index = roots[t];
+				while (nodes[index].next >= 0) {
+					const Node & node = nodes[index];
+					int feature = read(offsets[i], node.kb, node.lb) - read(offsets[i], node.ka, node.la);
+					index = node.next + (node.lo <= feature && feature <= node.hi ? 0 : 1);
+				}
+				const float * leaf = &leaves[~nodes[index].next * num_classes];
+				for (int c = 0; c < num_classes; c++) result[i * num_classes + c] += leaf[c];
+			}
+		}
+		for (int j = 0; j < count * num_classes; j++) result[j] /= weight_sum;
+	}
+}
@@ -0,0 +1,48 @@
+#pragma once
+#include <vector>
+#include <cstdint>
+#include <opencv2/core/core.hpp>
+#include "fertilized/fertilized_fwd.h"
+
+/// Random forest of hand_segmentation flattened for inference. The trees are stored breadth first in one node
+/// array (the two children of a node next to each other), the thresholds are quantized to the integer depth
+/// differences and the features are read from the depth image at the visited nodes only, instead of computing
+/// the (2 * radius + 1)^2 offsets of every pixel up front.
+/// @note same probabilities as fertilized::Forest::predict on the features computed by hand_segmentation
+class FlatForest {
+public:
+	typedef fertilized::Forest<float, float, unsigned int, std::vector<float>, std::vector<float>> Forest;
+
+	///--- Feature f = k * side + l is the depth at offset ((k - radius), (l - radius)) * (delta / d) / radius, minus d
+	static const int radius = 8;
+	static const int side = 2 * radius + 1;
+	static const int num_offsets = side * side;
+	static const int center = num_offsets / 2; ///< offset of the pixel itself
+	static const int batch_size = 64; ///< pixels that go through a tree before the next one
+
+	struct Node {
+		int lo, hi; ///< goes left iff lo <= feature <= hi
+		uint8_t ka, la, kb, lb; ///< feature = depth at offset (kb, lb) - depth at offset (ka, la)
+		int next; ///< left child if >= 0 (right child at next + 1), leaf ~next otherwise
+	};
+
+private:
+	std::vector<Node> nodes;
+	std::vector<int> roots;
+	std::vector<float> leaves; ///< num_classes per leaf, times the weight of its tree
+	int num_classes = 0;
+	float weight_sum = 0;
+	double delta = 0;
+	int background = 0;
+
+public:
+	/// @param delta, background as in the features the forest was trained on
+	/// @return false if the forest uses a decider, feature or leaf manager that cannot be flattened (then empty)
+	bool init(const Forest & forest, double delta, int background);
+	bool empty() const { return roots.empty(); }
+	int classes() const { return num_classes; }
+
+	/// @param depth CV_16UC1, with the invalid pixels set to the background
+	/// @param probabilities num_classes per location
+	void predict(const cv::Mat & depth, const std::vector<cv::Point> & locations, std::vector<float> & probabilities) const;
+};
@@ -14,6 +14,7 @@
 #include <algorithm>
 
 #include "segmentation/libseg.h"
+#include "segmentation/FlatForest.h"
 
 #define KERNEL_SIZE 3
 #define BACKGROUND_DEPTH 3000
@@ -34,6 +35,9 @@ static int D_height = 480;
 
 static auto soil = fertilized::Soil<float, float, fertilized::uint, fertilized::Result_Types::probabilities>();
 static auto forest = soil.ForestFromFile("ff_handsegmentation.ff");
+/// Same forest flattened for inference, empty if it cannot be (then the features are computed for fertilized)
+static FlatForest flat_forest;
+static bool flat_forest_ready = flat_forest.init(*forest, DELTA, BACKGROUND_DEPTH);
 
 void hand_segmentation(cv::Mat& depth, cv::Mat& color, cv::Mat &sensor_silhouette)
 {
@@ -81,60 +85,69 @@ void hand_segmentation(cv::Mat& depth, cv::Mat& color, cv::Mat &sensor_silhouett
 	int n_samples = locations.size();
 
 
-	fertilized::Array<float, 2, 2> new_data = fertilized::allocate(n_samples, n_features);
+	// build probability maps for current frame: hand and wrist
+	cv::Mat probabilityMap = cv::Mat::zeros(SRC_ROWS, SRC_COLS, CV_32F);
+	cv::Mat probabilityMap_w = cv::Mat::zeros(SRC_ROWS, SRC_COLS, CV_32F);
+	if (flat_forest_ready)
 	{
-		// Extract the lines serially, since the Array class is not thread-safe (yet)
-		std::vector<fertilized::Array<float, 2, 2>::Reference> lines;
-		for (int i = 0; i < n_samples; ++i)
+		// features read from the depth at the nodes of the flattened trees
+		std::vector<float> probabilities;
+		flat_forest.predict(sensor_depth_ds, locations, probabilities);
+		int n_classes = flat_forest.classes();
+		for (int j = 0; j < n_samples; j++)
 		{
-			lines.push_back(new_data[i]);
+			probabilityMap.at<float>(locations[j]) = probabilities[j * n_classes + 1];
+			probabilityMap_w.at<float>(locations[j]) = probabilities[j * n_classes + 2];
 		}
-#pragma omp parallel for num_threads(N_THREADS) \
-			//default(none) /* Require explicit spec. */\
-			shared(ptr,new_data) \
-			schedule(static)
-		for (int j = 0; j < n_samples; j++)
+	}
+	else
+	{
+		fertilized::Array<float, 2, 2> new_data = fertilized::allocate(n_samples, n_features);
 		{
-			// depth of current pixel
-			//Array<float, 2, 2> line = allocate(1, n_features);
-			std::vector<float> features;
-			float d = (float)ptr[elem_step*locations[j].y + locations[j].x];
-			for (int k = 0; k < (2 * N_FEAT + 1); k++)
+			// Extract the lines serially, since the Array class is not thread-safe (yet)
+			std::vector<fertilized::Array<float, 2, 2>::Reference> lines;
+			for (int i = 0; i < n_samples; ++i)
+			{
+				lines.push_back(new_data[i]);
+			}
+#pragma omp parallel for num_threads(N_THREADS) \
+				//default(none) /* Require explicit spec. */\
+				shared(ptr,new_data) \
+				schedule(static)
+			for (int j = 0; j < n_samples; j++)
 			{
-				int idx_x = locations[j].x + (int)(DELTA / d) * ((k - N_FEAT) / N_FEAT);
-				for (int l = 0; l < (2 * N_FEAT + 1); l++)
+				// depth of current pixel
+				//Array<float, 2, 2> line = allocate(1, n_features);
+				std::vector<float> features;
+				float d = (float)ptr[elem_step*locations[j].y + locations[j].x];
+				for (int k = 0; k < (2 * N_FEAT + 1); k++)
 				{
-					int idx_y = locations[j].y + (int)(DELTA / d) * ((l - N_FEAT) / N_FEAT);
-					// read data
-					if (idx_x < 0 || idx_x > SRC_COLS || idx_y < 0 || idx_y > SRC_ROWS)
+					int idx_x = locations[j].x + (int)(DELTA / d) * ((k - N_FEAT) / N_FEAT);
+					for (int l = 0; l < (2 * N_FEAT + 1); l++)
 					{
-						features.push_back(BACKGROUND_DEPTH - d);
-						continue;
+						int idx_y = locations[j].y + (int)(DELTA / d) * ((l - N_FEAT) / N_FEAT);
+						// read data
+						if (idx_x < 0 || idx_x > SRC_COLS || idx_y < 0 || idx_y > SRC_ROWS)
+						{
+							features.push_back(BACKGROUND_DEPTH - d);
+							continue;
+						}
+						float d_idx = (float)ptr[elem_step*idx_y + idx_x];
+						features.push_back(d_idx - d);
 					}
-					float d_idx = (float)ptr[elem_step*idx_y + idx_x];
-					features.push_back(d_idx - d);
 				}
+				std::copy(features.begin(), features.end(), lines[j].getData());
 			}
-			std::copy(features.begin(), features.end(), lines[j].getData());
 		}
-	}
-
-	// predict data
-	fertilized::Array<double, 2, 2> predictions = forest->predict(new_data, N_THREADS);
 
-	// build probability maps for current frame
-	// hand
-	cv::Mat probabilityMap = cv::Mat::zeros(SRC_ROWS, SRC_COLS, CV_32F);
-	for (size_t j = 0; j < locations.size(); j++)
-	{
-		probabilityMap.at<float>(locations[j]) = predictions[j][1];
-	}
+		// predict data
+		fertilized::Array<double, 2, 2> predictions = forest->predict(new_data, N_THREADS);
 
-	//wrist
-	cv::Mat probabilityMap_w = cv::Mat::zeros(SRC_ROWS, SRC_COLS, CV_32F);
-	for (size_t j = 0; j < locations.size(); j++)
-	{
-		probabilityMap_w.at<float>(locations[j]) = predictions[j][2];
+		for (int j = 0; j < n_samples; j++)
+		{
+			probabilityMap.at<float>(locations[j]) = predictions[j][1];
+			probabilityMap_w.at<float>(locations[j]) = predictions[j][2];
+		}
 	}
 
 	cv::Mat mask_ds = probabilityMap > THRESHOLD;
@@ -71,15 +71,6 @@ Camera::Camera(CAMERAMODE mode, int fps):_mode(mode), _fps(fps){
     iproj = proj.inverse();
 }
 
-Vector3 Camera::depth_to_world(Real i, Real j, Real depth){
-#ifndef USE_TOMPSON_FIX
-    Vector3 wrld = iproj * Vector3( i*depth, (height()-j-1)*depth, depth );
-#else
-    Vector3 wrld = iproj * Vector3( (i + 1)*depth, (height() - (j + 1)) * depth, depth );
-#endif
-    return wrld;
-}
-
 Vector3 Camera::unproject(int i, int j, Scalar depth){
     return pixel_to_image_plane(i,j) * depth;
 }
@@ -46,7 +46,15 @@ public:
 
 public:
     Vector2 world_to_image(const Vector3& wrld);
-    Vector3 depth_to_world(Real i, Real j, Real depth);
+    /// @note inline, called per pixel by HandFinder
+    Vector3 depth_to_world(Real i, Real j, Real depth){
+#ifndef USE_TOMPSON_FIX
+        Vector3 wrld = iproj * Vector3( i*depth, (height()-j-1)*depth, depth );
+#else
+        Vector3 wrld = iproj * Vector3( (i + 1)*depth, (height() - (j + 1)) * depth, depth );
+#endif
+        return wrld;
+    }
     Vector3 unproject(int i, int j, Scalar depth);
     Vector3 pixel_to_image_plane(int i, int j);
 };
@@ -51,6 +51,13 @@ inline std::ostream& operator<< (std::ostream& d, CustomJointInfo val) {
 
 #define CHAIN_MAX_LENGTH 15
 struct ChainElement{ int data[CHAIN_MAX_LENGTH]; };
+
+/// Jacobian row of a constraint attached to a chain, only the dofs of the chain can be non-zero
+struct SparseRow{
+    int size;                      ///< number of non-zeros
+    int index[CHAIN_MAX_LENGTH];   ///< jacobian column (CustomJointInfo::index)
+    float value[CHAIN_MAX_LENGTH];
+};
 typedef std::vector<ChainElement> KinematicChain; ///< row major!
 
 inline void clear_kinematic(KinematicChain& chain){
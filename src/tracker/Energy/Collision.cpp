@@ -177,15 +177,15 @@ namespace geometry {
 } ///< geometry::
 
 // Apply transformation to the given point
-Vector3 transform_point_position(Vector3 point, Mat4f transformation) {
-	Eigen::VectorXf homogen_point(4);
+Vector3 transform_point_position(const Vector3 & point, const Mat4f & transformation) {
+	Vector4 homogen_point;
 	homogen_point << point, 1.0;
-	Eigen::VectorXf transformed_homogen_point = transformation * homogen_point;
+	Vector4 transformed_homogen_point = transformation * homogen_point;
 	return (transformed_homogen_point / transformed_homogen_point[3]).head(3);
 }
 
 // Return axis endpoint of the segment
-std::pair<Vector3, Vector3> get_axis_endpoints(Phalange phalange) {
+std::pair<Vector3, Vector3> get_axis_endpoints(const Phalange & phalange) {
 	Vector3 axis_start = Vector3(0, 0, 0);
 	Vector3 axis_end = Vector3(0, phalange.length, 0);
 	Vector3 transformed_axis_start = transform_point_position(axis_start, phalange.global.cast<float>());
@@ -211,8 +211,8 @@ void debug_display_constraints(std::pair<Vector3, Vector3> shortest_path, Vector
 // A(i, j) = 1, if i is adjacent to j
 // A(i, j) = 2, if i should not be compared to j
 // A(i, j) = 0, if we should test the joint i and j for collision
-Matrix_MxN create_adjacency_matrix(std::vector<Phalange> phalanges) {
-	Matrix_MxN adjacency_matrix = Matrix_MxN::Zero(num_phalanges - 1, num_phalanges - 1);
+void create_adjacency_matrix(const std::vector<Phalange> & phalanges, energy::Collision::AdjacencyMatrix & adjacency_matrix) {
+	adjacency_matrix.setZero();
 	for (int i = 0; i < num_phalanges - 1; i++) {
 		if (phalanges[i].parent_id >= 0 && phalanges[i].parent_id < num_phalanges - 1)
 			adjacency_matrix(i, phalanges[i].parent_id) = 1;
@@ -220,17 +220,14 @@ Matrix_MxN create_adjacency_matrix(std::vector<Phalange> phalanges) {
 			adjacency_matrix(i, phalanges[i].children_ids[j]) = 1;
 		}
 	}
-	return adjacency_matrix;
 }
 
-std::vector<std::vector<std::pair<Vector3, Vector3>>> create_distance_matrix(std::vector<Phalange> phalanges, Matrix_MxN adjacency_matrix) {
-
-	std::vector<std::vector<std::pair<Vector3, Vector3>>> distance_matrix;
+void create_distance_matrix(const std::vector<Phalange> & phalanges, const energy::Collision::AdjacencyMatrix & adjacency_matrix, energy::Collision::DistanceMatrix & distance_matrix) {
 	std::pair<Vector3, Vector3> big_distance(Vector3(0, 0, 0), Vector3(RAND_MAX, RAND_MAX, RAND_MAX));
-	std::vector<std::pair<Vector3, Vector3>> current_row(num_phalanges - 1, big_distance);
-	distance_matrix.push_back(current_row);
+	for (int i = 0; i < num_phalanges - 1; i++)
+		for (int j = 0; j < num_phalanges - 1; j++)
+			distance_matrix[i][j] = big_distance;
 	for (int i = 1; i < num_phalanges - 1; i++) {
-		distance_matrix.push_back(current_row);
 		for (int j = 1; j < i; j++) {
 			if (adjacency_matrix(i, j) != 0) continue;
 			std::pair<Vector3, Vector3> shortest_path =
@@ -245,13 +242,16 @@ std::vector<std::vector<std::pair<Vector3, Vector3>>> create_distance_matrix(std
 		}
 		}
 		}*/
-	return distance_matrix;
 }
 
 namespace energy {
 
 	void Collision::init(Model * model) {
 		this->model = model;
+		int max_num_constraints = num_phalanges * (num_phalanges - 1) / 2; ///< one per pair of phalanges
+		s.reserve(max_num_constraints);
+		t.reserve(max_num_constraints);
+		n.reserve(max_num_constraints);
 	}
 	
 	Scalar Collision::create_collision_constraints() {
@@ -261,14 +261,15 @@ namespace energy {
 		// TIMED_SCOPE(timer, "Worker::create_collision_constraints");
 		s.clear();
 		t.clear();
+		n.clear();
 
-		Matrix_MxN adjacency_matrix = create_adjacency_matrix(model->phalanges);
+		create_adjacency_matrix(model->phalanges, adjacency_matrix);
 		
-		std::vector<std::vector<std::pair<Vector3, Vector3>>> distance_matrix = create_distance_matrix(model->phalanges, adjacency_matrix);
+		create_distance_matrix(model->phalanges, adjacency_matrix, distance_matrix);
 
 		for (int i = discard_palm; i < num_phalanges - 1; i++) {
 			for (int j = discard_palm; j < i; j++) {
-				std::pair<Vector3, Vector3> shortest_path = distance_matrix[i][j];
+				const std::pair<Vector3, Vector3> & shortest_path = distance_matrix[i][j];
 				float distance = (shortest_path.first - shortest_path.second).norm();
 				if (distance > FLT_MIN && distance < (model->phalanges[i].radius2 + model->phalanges[j].radius2)) {
 
@@ -292,22 +293,26 @@ namespace energy {
 	void Collision::collision_compute_update(LinearSystem &system, Scalar omega) {
 		// TIMED_SCOPE(timer,"Worker::collision_compute_update");		
 		const int k = max(s.size(), t.size());
-		Matrix_MxN J; VectorN rhs;
 
-		Scalar c = 2;
+		///--- Two rows per constraint, accumulated into Jt*J and Jt*e (J is never stored)
 		Scalar fraction = settings->collision_fraction;
-		J = Matrix_MxN::Zero(c * k, num_thetas);
-		rhs = VectorN::Zero(c * k);
+		Eigen::Matrix<Scalar, num_thetas, num_thetas> JtJ = Eigen::Matrix<Scalar, num_thetas, num_thetas>::Zero();
+		Thetas Jte = Thetas::Zero();
+		Eigen::Matrix<Scalar, 1, num_thetas> J_row;
 		for (int i = 0; i < k; ++i) {
-			J.block(c * i, 0, 1, num_thetas) = n[i].transpose() * model->jacobian(s[i].p, s[i].id);
-			rhs.block(c * i, 0, 1, 1) = fraction * n[i].transpose() * (t[i].p - s[i].p);
-			J.block(c * i + 1, 0, 1, num_thetas) = n[i].transpose() * model->jacobian(t[i].p, t[i].id);
-			rhs.block(c * i + 1, 0, 1, 1) = fraction *  n[i].transpose() * (s[i].p - t[i].p);
+			J_row = n[i].transpose() * model->jacobian(s[i].p, s[i].id);
+			J_row.head(num_thetas_rigid_motion).setZero();
+			JtJ.noalias() += J_row.transpose() * J_row;
+			Jte += J_row.transpose() * (fraction * n[i].dot(t[i].p - s[i].p));
+
+			J_row = n[i].transpose() * model->jacobian(t[i].p, t[i].id);
+			J_row.head(num_thetas_rigid_motion).setZero();
+			JtJ.noalias() += J_row.transpose() * J_row;
+			Jte += J_row.transpose() * (fraction * n[i].dot(s[i].p - t[i].p));
 		}
-		J.block(0, 0, c * k, num_thetas_rigid_motion) = Matrix_MxN::Zero(c * k, num_thetas_rigid_motion);
 
-		system.lhs += omega * J.transpose() * J;
-		system.rhs += omega * J.transpose() * rhs;
+		system.lhs.topLeftCorner(num_thetas, num_thetas) += omega * JtJ;
+		system.rhs.head(num_thetas) += omega * Jte;
 	}
 
 	void Collision::track(LinearSystem& system) {
@@ -3,6 +3,7 @@
 #include "Energy.h"
 #include "tracker/Types.h"
 #include <vector>
+#include <utility>
 
 namespace energy{
 
@@ -26,12 +27,19 @@ public:
         }
     };
 	
+    typedef Eigen::Matrix<Scalar, num_phalanges - 1, num_phalanges - 1> AdjacencyMatrix;
+    typedef std::pair<Vector3, Vector3> DistanceMatrix[num_phalanges - 1][num_phalanges - 1];
+
 private:
 	Model * model = NULL;
     std::vector<Point> s;
     std::vector<Point> t;
     std::vector<Vector3> n;
 
+    ///--- Workspaces of create_collision_constraints
+    AdjacencyMatrix adjacency_matrix;
+    DistanceMatrix distance_matrix;
+
 public:
     void init(Model * model);
     void track(LinearSystem& system);
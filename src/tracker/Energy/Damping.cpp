@@ -1,6 +1,7 @@
 #include "Damping.h"
 #include "tracker/TwSettings.h"
 #include "tracker/HModel/Model.h"
+#include <algorithm>
 
 namespace energy {
 
@@ -8,12 +9,28 @@ namespace energy {
 		this->model = model;
 		tw_settings->tw_add(settings->translation_damping, "translations", "group=Damping");
 		tw_settings->tw_add(settings->rotation_damping, "rotations", "group=Damping");
+		tw_settings->tw_add(settings->lm_enable, "LM (enable)", "group=Damping");
+		tw_settings->tw_add(settings->lm_lambda_min, "LM (min)", "group=Damping");
+		tw_settings->tw_add(settings->lm_lambda_max, "LM (max)", "group=Damping");
+	}
+
+	/// Decreases lambda when the energy went down since the previous iteration, increases it otherwise
+	void Damping::update(int iter, Scalar energy) {
+		if (iter == 0) {
+			lambda = settings->lm_lambda_init;
+		}
+		else if (energy < last_energy) {
+			lambda = std::max(lambda / 3, settings->lm_lambda_min);
+		}
+		else {
+			lambda = std::min(lambda * 2, settings->lm_lambda_max);
+		}
+		last_energy = energy;
 	}
 
 	void Damping::track(LinearSystem &system) {
 
-		Eigen::Matrix<Scalar, num_thetas, num_thetas> D = Eigen::Matrix<Scalar, num_thetas, num_thetas>::Identity(system.lhs.rows(), system.lhs.cols());
-		Eigen::Matrix<Scalar, num_thetas, 1>  d = Eigen::Matrix<Scalar, num_thetas, 1>::Ones(system.lhs.rows(), 1);
+		Eigen::Matrix<Scalar, num_thetas, 1>  d = Eigen::Matrix<Scalar, num_thetas, 1>::Ones();
 
 		float max_JtJ = 0;
 		/*for (int i = 0; i < num_thetas; ++i) {
@@ -32,8 +49,8 @@ namespace energy {
 			//d(i) = d(i) * system.lhs(i, i) / max_JtJ;			
 		}
 		//cout << d.transpose() << endl;
-		D.diagonal() = d;
-		system.lhs = system.lhs + D;
+		if (settings->lm_enable) d *= lambda;
+		system.lhs.diagonal().head(num_thetas) += d;
 
 		if (Energy::safety_check) Energy::has_nan(system);
 	}
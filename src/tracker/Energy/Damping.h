@@ -15,12 +15,22 @@ public:
 		Scalar rotation_damping = 3000;
 		Scalar abduction_damping = 1500000; 
 		Scalar top_phalange_damping = 10000;
+		///--- Levenberg-Marquardt: the damping above is scaled by lambda, adapted at every iteration
+		bool lm_enable = false;
+		Scalar lm_lambda_init = 1;
+		Scalar lm_lambda_min = 0.1f;
+		Scalar lm_lambda_max = 100;
     } _settings;
     Settings*const settings = &_settings;
 
+private:
+	Scalar lambda = 1;
+	Scalar last_energy = 0;
 
+public:
     void init(Model * model);
     void track(LinearSystem& system);
+    void update(int iter, Scalar energy); ///< adapts lambda, call once per iteration before track
 };
 
 }
@@ -49,22 +49,20 @@ void Energy::rigid_only(LinearSystem &system){
     // if(has_nan(system)) cout << "NAN " << __LINE__ << endl;
 }
 
-VectorN Energy::solve(LinearSystem &system){
-    ///--- Solve for update dt = (J^T * J + D)^-1 * J^T * r
-    VectorN solution = system.lhs.colPivHouseholderQr().solve(system.rhs);
-
+/// @return update of the thetas, zero if the solution has NaNs
+static Thetas thetas_from_solution(const Vector_System& solution){
     ///--- Check for NaN
     for(int i=0; i<solution.size(); i++){
         if( isnan( solution[i]) ){
             LOG(INFO) << "-------------------------------------------------------------";
             LOG(INFO) << "!!!WARNING: NaN DETECTED in the solution!!! (skipping update)";
             LOG(INFO) << "-------------------------------------------------------------";
-            return VectorN::Zero(num_thetas,1);
+            return Thetas::Zero();
         }
     }
 
     ///--- Only take portion of solution for hand
-    VectorN delta_thetas = solution.head(num_thetas);
+    Thetas delta_thetas = solution.head(num_thetas);
 
     ///--- Debug
     if(debug_print_delta_theta)
@@ -73,4 +71,94 @@ VectorN Energy::solve(LinearSystem &system){
     return delta_thetas;
 }
 
+/// Dense solve of the (damped) normal equations
+static Vector_System solve_dense(const LinearSystem& system){
+    ///--- Solve for update dt = (J^T * J + D)^-1 * J^T * r
+    ///    The damped system is symmetric positive (semi)definite, QR is only a fallback
+    Eigen::LDLT<Matrix_System> ldlt(system.lhs);
+    Vector_System solution = ldlt.solve(system.rhs);
+    if (ldlt.info() != Eigen::Success || !solution.allFinite())
+        solution = system.lhs.colPivHouseholderQr().solve(system.rhs);
+    return solution;
+}
+
+Thetas Energy::solve(LinearSystem &system){
+    return thetas_from_solution(solve_dense(system));
+}
+
+Thetas Energy::solve_fingers(LinearSystem &system, const bool* frozen){
+    typedef Eigen::Matrix<Scalar, num_thetas_finger, num_thetas_finger> Matrix_Finger;
+    typedef Eigen::Matrix<Scalar, num_thetas_finger, 1> Vector_Finger;
+    typedef Eigen::Matrix<Scalar, num_thetas_finger, Eigen::Dynamic, Eigen::ColMajor, num_thetas_finger, num_system_max> Matrix_FingerxGlobal;
+    const int n = system.lhs.rows();
+    const int F = num_thetas_finger;
+
+    ///--- Frozen fingers are removed from the system, as in rigid_only
+    if (frozen) {
+        for (int k = 0; k < num_fingers; ++k) {
+            if (!frozen[k]) continue;
+            int start = num_thetas_ignore + k * F;
+            system.lhs.middleCols(start, F).setZero();
+            system.lhs.middleRows(start, F).setZero();
+            system.rhs.segment(start, F).setZero();
+        }
+    }
+
+    ///--- Fingers coupled directly, no arrow structure
+    for (int a = 0; a < num_fingers; ++a)
+        for (int b = a + 1; b < num_fingers; ++b)
+            if (!system.lhs.block(num_thetas_ignore + a * F, num_thetas_ignore + b * F, F, F).isZero(0))
+                return solve(system);
+
+    ///--- Global dofs: before the fingers (rigid motion, wrist) and after them (latent variables)
+    int globals[num_system_max];
+    int num_globals = 0;
+    for (int i = 0; i < num_thetas_ignore; ++i) globals[num_globals++] = i;
+    for (int i = num_thetas; i < n; ++i) globals[num_globals++] = i;
+
+    Matrix_System S(num_globals, num_globals); ///< Schur complement of the finger blocks
+    Vector_System s(num_globals);
+    for (int j = 0; j < num_globals; ++j) {
+        s(j) = system.rhs(globals[j]);
+        for (int i = 0; i < num_globals; ++i) S(i, j) = system.lhs(globals[i], globals[j]);
+    }
+
+    ///--- Finger blocks, independent of each other
+    Matrix_FingerxGlobal B[num_fingers]; ///< coupling with the globals
+    Matrix_FingerxGlobal AinvB[num_fingers];
+    Vector_Finger Ainvr[num_fingers];
+    bool active[num_fingers];
+    for (int k = 0; k < num_fingers; ++k) {
+        int start = num_thetas_ignore + k * F;
+        active[k] = !(frozen && frozen[k]);
+        if (!active[k]) continue;
+        B[k].resize(F, num_globals);
+        for (int j = 0; j < num_globals; ++j) B[k].col(j) = system.lhs.block(start, globals[j], F, 1);
+        Eigen::LDLT<Matrix_Finger> ldlt(system.lhs.block(start, start, F, F));
+        if (ldlt.info() != Eigen::Success || !ldlt.isPositive() || ldlt.vectorD().minCoeff() <= 0)
+            return solve(system); ///< undamped and degenerate, e.g. a finger without any constraint
+        AinvB[k] = ldlt.solve(B[k]);
+        Ainvr[k] = ldlt.solve(Vector_Finger(system.rhs.segment(start, F)));
+    }
+    for (int k = 0; k < num_fingers; ++k) {
+        if (!active[k]) continue;
+        S.noalias() -= B[k].transpose() * AinvB[k];
+        s.noalias() -= B[k].transpose() * Ainvr[k];
+    }
+
+    ///--- Globals first, then back substitution in each finger
+    LinearSystem reduced;
+    reduced.lhs = S;
+    reduced.rhs = s;
+    Vector_System dg = solve_dense(reduced);
+
+    Vector_System solution = Vector_System::Zero(n);
+    for (int j = 0; j < num_globals; ++j) solution(globals[j]) = dg(j);
+    for (int k = 0; k < num_fingers; ++k) {
+        if (!active[k]) continue;
+        solution.segment(num_thetas_ignore + k * F, F) = Ainvr[k] - AinvB[k] * dg;
+    }
+    return thetas_from_solution(solution);
+}
+
 } /// energy::
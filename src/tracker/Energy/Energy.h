@@ -16,7 +16,13 @@ protected:
 
 public:
     static void rigid_only(LinearSystem& system);
-    static VectorN solve(LinearSystem& system);
+    static Thetas solve(LinearSystem& system);
+
+    /// Same as solve, exploiting the arrow structure of the system: the finger blocks only couple through
+    /// the global dofs (rigid motion, wrist and the latent variables of PoseSpace). Falls back to solve
+    /// when two fingers are coupled directly (e.g. by collisions).
+    /// @param frozen num_fingers flags, the update of these fingers is zero (NULL if none)
+    static Thetas solve_fingers(LinearSystem& system, const bool* frozen = NULL);
 };
 
 }
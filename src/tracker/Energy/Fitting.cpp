@@ -132,4 +132,201 @@ energy::Fitting::~Fitting() {
 	kernel_delete();
 }
 
+#else
+#include "tracker/Energy/Fitting/ComputeJacobianData.h"
+#include "tracker/Energy/Fitting/ComputeJacobianSilhouette.h"
+#include "tracker/Energy/Fitting/NormalEquations.h"
+
+///--- Linear system of the CPU backend (same role as cudax::J and cudax::F)
+static energy::fitting::Matrix_MxTheta J; ///< only allocated if !fit_streaming
+static VectorN F;
+
+///--- Accumulators of the streaming assembly, summed in order so results do not depend on the thread count
+const int num_accumulators = 64;
+static std::vector<energy::fitting::NormalEquations> accumulators(num_accumulators);
+
+///--- Kept across iterations so the per-block buffers are not reallocated
+static energy::fitting::CorrespondencesFinder correspondences_finder;
+
+///--- Block assigned to each sensor point at the previous iteration (indexed like HandFinder::sensor_indicator)
+static std::vector<int> sensor_blocks(upper_bound_num_sensor_points, -1);
+
+void energy::Fitting::cleanup() {
+	distance_transform.cleanup();
+	J.resize(0, num_thetas);
+	F.resize(0);
+}
+
+void energy::Fitting::init(Worker *worker) {
+	this->camera = worker->camera;
+	this->sensor_depth_texture = worker->sensor_depth_texture;
+	this->handfinder = worker->handfinder;
+	this->model = worker->model;
+
+	///--- 3D fitting
+	tw_settings->tw_add(settings->fit3D_enable, "E_3D (enable)", "group=Fitting");
+	tw_settings->tw_add(settings->fit3D_weight, "E_3D (weight)", "group=Fitting");
+	tw_settings->tw_add(settings->fit3D_reweight, "E_3D (l1nrm?)", "group=Fitting");
+	tw_settings->tw_add(settings->fit3D_point2plane, "E_3D (p2P?)", "group=Fitting");
+	///--- 2D fitting
+	tw_settings->tw_add(settings->fit2D_enable, "E_2D (enable)", "group=Fitting");
+	tw_settings->tw_add(settings->fit2D_weight, "E_2D (weight)", "group=Fitting");
+	///--- Assembly
+	tw_settings->tw_add(settings->fit_streaming, "streaming JtJ", "group=Fitting");
+
+	distance_transform.init(camera->width(), camera->height());
+}
+
+void energy::Fitting::track(DataFrame& frame, LinearSystem& sys, bool rigid_only, bool eval_error, float & push_error, float & pull_error, int iter) {
+	assert(frame.depth.isContinuous());
+	if (eval_error) push_error = pull_error = 0; ///< also the errors of a term without constraints
+
+	cv::Mat& sensor_silhouette = handfinder->sensor_silhouette;
+	static int last_computed_id = -1;
+	static cv::Mat sensor_silhouette_flipped;
+
+	// Compute distance transform
+	if (settings->fit2D_enable && last_computed_id != frame.id) {
+		cv::flip(sensor_silhouette, sensor_silhouette_flipped, 0 /*flip rows*/);
+		distance_transform.exec(sensor_silhouette_flipped.data, 125);
+		last_computed_id = frame.id;
+	}
+
+	// Compute rendered outline
+	int num_rendered_points = 0;
+	if (settings->fit2D_enable) {
+		model->compute_rendered_indicator(sensor_silhouette, camera);
+		num_rendered_points = std::min(model->num_rendered_points, upper_bound_num_rendered_outline_points);
+	}
+
+	int num_sensor_points = std::min(handfinder->num_sensor_points, upper_bound_num_sensor_points);
+	int n_push = 2 * num_rendered_points;
+	int n_pull = 1 * num_sensor_points; // point to plane
+	int n_total = n_pull + n_push;
+	if (n_total == 0) return;
+
+	// Model as exposed by ModelSerializer::serialize_model (views of the model vectors)
+	correspondences_finder.centers = model->host_pointer_centers;
+	correspondences_finder.radii = model->host_pointer_radii;
+	correspondences_finder.blocks = model->host_pointer_blocks;
+	correspondences_finder.tangent_points = model->host_pointer_tangent_points;
+	correspondences_finder.outline = model->host_pointer_outline;
+	correspondences_finder.num_centers = model->centers.size();
+	correspondences_finder.num_blocks = model->blocks.size();
+	correspondences_finder.num_outlines = model->outline_finder.outline3D.size();
+	correspondences_finder.num_tangent_fields = model->num_tangent_fields;
+	correspondences_finder.num_outline_fields = model->num_outline_fields;
+	correspondences_finder.update();
+
+	bool reweight = settings->fit3D_reweight;
+	if (rigid_only && settings->fit3D_reweight && !(settings->fit3D_reweight_rigid))
+		reweight = false; ///< allows fast rigid motion (mostly visible on PrimeSense @60FPS)
+
+	fitting::ComputeJacobianSilhouette functor_push(model->transformations, model->kinematic_chain,
+		distance_transform.idxs_image_ptr(), model->host_pointer_blockid_to_jointid_map,
+		model->rendered_pixels, model->rendered_points, model->rendered_block_ids,
+		camera->width(), camera->height(), camera->focal_length_x(), camera->focal_length_y(), settings);
+	fitting::ComputeJacobianData functor_data_model(model->transformations, model->kinematic_chain,
+		correspondences_finder, model->host_pointer_blockid_to_jointid_map,
+		(const unsigned short*) frame.depth.data, camera->inv_projection_matrix(), camera->width(), camera->height(), settings, reweight);
+
+	const int* sensor_indicator = handfinder->sensor_indicator;
+	int num_push_samples = settings->fit2D_enable ? num_rendered_points : 0;
+	int num_pull_samples = settings->fit3D_enable ? num_sensor_points : 0;
+	const int batch_size = fitting::correspondences_batch_size;
+
+	// Warm start the correspondences from the previous iteration of the same frame
+	if (iter == 0) std::fill(sensor_blocks.begin(), sensor_blocks.begin() + num_sensor_points, -1);
+	int* blocks = sensor_blocks.data();
+
+	if (settings->fit_streaming) {
+		// Each accumulator owns a contiguous range of constraints (push samples first, then pull)
+		int num_samples = num_push_samples + num_pull_samples;
+		#pragma omp parallel for schedule(dynamic)
+		for (int k = 0; k < num_accumulators; ++k) {
+			fitting::NormalEquations& accumulator = accumulators[k];
+			accumulator.setZero();
+			SparseRow J_sub[fitting::correspondences_batch_size];
+			Scalar e_sub[fitting::correspondences_batch_size];
+			bool valid[fitting::correspondences_batch_size];
+			int begin = num_samples * k / num_accumulators;
+			int end = num_samples * (k + 1) / num_accumulators;
+			for (int i = begin; i < std::min(end, num_push_samples); ++i) {
+				functor_push(i, J_sub, e_sub);
+				accumulator.add(J_sub[0], e_sub[0]);
+				accumulator.add(J_sub[1], e_sub[1]);
+				accumulator.push_error += std::abs(e_sub[0]) + std::abs(e_sub[1]);
+			}
+			for (int i = std::max(begin, num_push_samples); i < end; i += batch_size) {
+				int n = std::min(batch_size, end - i);
+				functor_data_model(sensor_indicator + i - num_push_samples, n, blocks + i - num_push_samples, J_sub, e_sub, valid);
+				for (int l = 0; l < n; ++l) {
+					if (!valid[l]) continue;
+					accumulator.add(J_sub[l], e_sub[l]);
+					accumulator.pull_error += std::abs(e_sub[l]);
+				}
+			}
+		}
+
+		// Final reduction
+		for (int k = 1; k < num_accumulators; ++k)
+			accumulators[0] += accumulators[k];
+		accumulators[0].symmetrize();
+		sys.lhs += accumulators[0].JtJ;
+		sys.rhs += accumulators[0].JtF;
+
+		/// Only need evaluate metric on the last iteration
+		if (eval_error) {
+			if (n_pull > 0) pull_error = accumulators[0].pull_error / n_pull;
+			if (n_push > 0) push_error = accumulators[0].push_error / n_push;
+		}
+		return;
+	}
+
+	if (J.rows() < n_total) {
+		J.resize(upper_bound_num_sensor_points + 2 * upper_bound_num_rendered_outline_points, num_thetas);
+		F.resize(J.rows());
+	}
+	J.topRows(n_total).setZero();
+	F.head(n_total).setZero();
+
+	Scalar* J_push = J.data();
+	Scalar* J_pull = J_push + num_thetas * n_push;
+	Scalar* F_push = F.data();
+	Scalar* F_pull = F_push + n_push;
+
+	// Assemble Jacobian (scatter the sparse rows)
+	#pragma omp parallel for
+	for (int i = 0; i < num_push_samples; ++i) {
+		SparseRow J_sub[2];
+		functor_push(i, J_sub, F_push + 2 * i);
+		for (int k = 0; k < J_sub[0].size; ++k) {
+			J_push[num_thetas * (2 * i) + J_sub[0].index[k]] = J_sub[0].value[k];
+			J_push[num_thetas * (2 * i + 1) + J_sub[1].index[k]] = J_sub[1].value[k];
+		}
+	}
+	#pragma omp parallel for
+	for (int i = 0; i < num_pull_samples; i += batch_size) {
+		SparseRow J_sub[fitting::correspondences_batch_size];
+		bool valid[fitting::correspondences_batch_size];
+		int n = std::min(batch_size, num_pull_samples - i);
+		functor_data_model(sensor_indicator + i, n, blocks + i, J_sub, F_pull + i, valid);
+		for (int l = 0; l < n; ++l) {
+			if (!valid[l]) continue;
+			for (int k = 0; k < J_sub[l].size; ++k)
+				J_pull[num_thetas * (i + l) + J_sub[l].index[k]] = J_sub[l].value[k];
+		}
+	}
+
+	// Jt*J and Jt*e
+	sys.lhs.noalias() += J.topRows(n_total).transpose() * J.topRows(n_total);
+	sys.rhs.noalias() += J.topRows(n_total).transpose() * F.head(n_total);
+
+	/// Only need evaluate metric on the last iteration
+	if (eval_error) {
+		if (n_pull > 0) pull_error = F.segment(n_push, n_pull).cwiseAbs().sum() / n_pull;
+		if (n_push > 0) push_error = F.head(n_push).cwiseAbs().sum() / n_push;
+	}
+}
+
 #endif
@@ -25,9 +25,10 @@ public:
     void cleanup();
 	~Fitting();
 #else
-    void track(DataFrame &frame, LinearSystem &sys, bool rigid_only, bool eval_error, float &push_error, float &pull_error){}
-    void init(Worker* worker){}
-    void cleanup(){}
+    ///--- Multithreaded CPU backend (see Fitting.cpp)
+    void track(DataFrame &frame, LinearSystem &sys, bool rigid_only, bool eval_error, float &push_error, float &pull_error, int iter);
+    void init(Worker* worker);
+    void cleanup();
 #endif
 };
 } /// energy::
@@ -0,0 +1,114 @@
+#pragma once
+#include "ComputeJacobianRow.h"
+#include "CorrespondencesFinder.h"
+#include "Settings.h"
+
+/// @note host counterpart of cudax/functors/ComputeJacobianData.h (point to plane only)
+namespace energy {
+namespace fitting {
+
+class ComputeJacobianData : public ComputeJacobianRow {
+	const CorrespondencesFinder& correspondences_finder;
+	const int* blockid_to_jointid_map;
+
+	const unsigned short* depth; ///< CV_16UC1, row major
+	Matrix3 iproj; ///< to compute cloud from depth
+	int width;
+	int height;
+
+	float weight;
+	bool reweight;
+
+public:
+	ComputeJacobianData(const JointTransformations& jointinfos, const KinematicChain& chains,
+		const CorrespondencesFinder& correspondences_finder, const int* blockid_to_jointid_map,
+		const unsigned short* depth, const Matrix3& iproj, int width, int height, const Settings* settings, bool reweight) :
+		ComputeJacobianRow(jointinfos, chains),
+		correspondences_finder(correspondences_finder),
+		blockid_to_jointid_map(blockid_to_jointid_map),
+		depth(depth), iproj(iproj), width(width), height(height) {
+		this->weight = settings->fit3D_weight;
+		this->reweight = reweight;
+	}
+
+	void skeleton_jacobian(const int joint_id, const glm::vec3& pos, SparseRow& J_sub, float weight, const glm::vec3& nrm) const {
+		int i_column = 0;
+		for (; i_column < CHAIN_MAX_LENGTH; i_column++) {
+			int jointinfo_id = chains[joint_id].data[i_column];
+			if (jointinfo_id == -1) break;
+			const CustomJointInfo& jinfo = jointinfos[jointinfo_id];
+			J_sub.index[i_column] = jinfo.index;
+			J_sub.value[i_column] = weight * glm::dot(skeleton_column(jinfo, pos), nrm);
+		}
+		J_sub.size = i_column;
+	}
+
+	/// @return false if the point has no valid correspondence
+	bool assemble_linear_system(const glm::vec3& p, SparseRow& J_sub, Scalar& e_sub) const {
+		glm::vec3 q, s;
+		glm::ivec3 index;
+		int b;
+
+		correspondences_finder.find(p, b, q, s, index);
+		return assemble_linear_system(p, b, q, J_sub, e_sub);
+	}
+
+	/// @param b, q correspondence of p as returned by CorrespondencesFinder::find
+	bool assemble_linear_system(const glm::vec3& p, int b, const glm::vec3& q, SparseRow& J_sub, Scalar& e_sub) const {
+		if (glm::length(p - q) < 1e-5) return false;
+		glm::vec3 n = (p - q) / glm::length(p - q);
+		if (std::isnan(n[0]) || std::isnan(n[1]) || std::isnan(n[2])) return false;
+
+		int joint_id = blockid_to_jointid_map[b];
+
+		float weight = this->weight;
+		if (reweight) {
+			float d = glm::length(p - q);
+			float w = 1.0f / std::sqrt(d + 1e-3f);
+			if (d > 1e-3) weight *= w * 3.5f; // factor 3.5 compensates for residual magnitude change
+		}
+
+		e_sub = weight * glm::dot(p - q, n);
+		skeleton_jacobian(joint_id, p, J_sub, weight, n);
+		return true;
+	}
+
+	/// @param index linear index (row*width+col) of a sensor pixel, as in HandFinder::sensor_indicator
+	/// @param J_sub jacobian row
+	/// @param e_sub residual
+	bool operator()(int index, SparseRow& J_sub, Scalar& e_sub) const {
+		return assemble_linear_system(sensor_point(index), J_sub, e_sub);
+	}
+
+	/// Batched version of the above, see CorrespondencesFinder::find_batch
+	/// @param indices up to correspondences_batch_size entries of HandFinder::sensor_indicator
+	/// @param blocks block of each point at the previous iteration (-1 if unknown), updated in place
+	/// @param valid false where the point has no valid correspondence
+	void operator()(const int* indices, int n, int* blocks, SparseRow* J_sub, Scalar* e_sub, bool* valid) const {
+		glm::vec3 p[correspondences_batch_size], q[correspondences_batch_size], s[correspondences_batch_size];
+		glm::ivec3 index[correspondences_batch_size];
+		int b[correspondences_batch_size];
+
+		for (int l = 0; l < n; ++l)
+			p[l] = sensor_point(indices[l]);
+		correspondences_finder.find_batch(p, n, blocks, b, q, s, index);
+		for (int l = 0; l < n; ++l) {
+			blocks[l] = b[l];
+			valid[l] = assemble_linear_system(p[l], b[l], q[l], J_sub[l], e_sub[l]);
+		}
+	}
+
+	/// Back-projection of a sensor pixel in camera coordinates
+	glm::vec3 sensor_point(int index) const {
+		int offset_y = index / width;
+		int offset_x = index - width * offset_y;
+		float depth = (float) this->depth[index];
+		offset_y = height - 1 - offset_y;
+
+		Vector3 wrld = iproj * Vector3(offset_x * depth, offset_y * depth, depth);
+		return glm::vec3(wrld[0], wrld[1], wrld[2]);
+	}
+};
+
+} /// fitting::
+} /// energy::
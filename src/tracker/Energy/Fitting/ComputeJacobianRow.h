@@ -0,0 +1,41 @@
+#pragma once
+#include "cudax/cuda_glm.h"
+#include "tracker/Types.h"
+#include "tracker/DataStructure/CustomJointInfo.h"
+
+/// @note host counterpart of cudax/functors/ComputeJacobianRow.h
+namespace energy {
+namespace fitting {
+
+/// Dense jacobian, one row per constraint (same layout as cudax::J_row)
+typedef Eigen::Matrix<Scalar, Eigen::Dynamic, num_thetas, Eigen::RowMajor> Matrix_MxTheta;
+
+class ComputeJacobianRow {
+protected:
+	const CustomJointInfo* jointinfos; ///< raw
+	const ChainElement* chains; ///< raw
+public:
+	ComputeJacobianRow(const JointTransformations& jointinfos, const KinematicChain& chains) {
+		this->jointinfos = jointinfos.data();
+		this->chains = chains.data();
+	}
+
+protected:
+	/// Derivative of the point pos (attached to the kinematic chain) w.r.t. the dof of jinfo
+	static glm::vec3 skeleton_column(const CustomJointInfo& jinfo, const glm::vec3& pos) {
+		const float* m = jinfo.mat; ///< column major
+		const float* a = jinfo.axis;
+		glm::vec3 t(m[12], m[13], m[14]);
+		glm::vec3 v(m[0] * a[0] + m[4] * a[1] + m[8] * a[2] + m[12],
+		            m[1] * a[0] + m[5] * a[1] + m[9] * a[2] + m[13],
+		            m[2] * a[0] + m[6] * a[1] + m[10] * a[2] + m[14]);
+		switch (jinfo.type) {
+		case 1: return v;
+		case 0: return glm::cross(glm::normalize(v - t), pos - t);
+		}
+		return glm::vec3(0);
+	}
+};
+
+} /// fitting::
+} /// energy::
@@ -0,0 +1,93 @@
+#pragma once
+#include "ComputeJacobianRow.h"
+#include "Settings.h"
+
+/// @note host counterpart of cudax/functors/ComputeJacobianSilhouette.h
+namespace energy {
+namespace fitting {
+
+class ComputeJacobianSilhouette : public ComputeJacobianRow {
+private:
+	///--- These are for the extra_push
+	const int* sensor_dtform_idxs; ///< DistanceTransform::idxs_image_ptr() of the flipped sensor silhouette
+	const int* blockid_to_jointid_map;
+	float weight;
+
+	const int* rendered_pixels;
+	const float* rendered_points;
+	const int* rendered_block_ids;
+
+	int width;
+	int height;
+	float focal_length_x;
+	float focal_length_y;
+
+public:
+	ComputeJacobianSilhouette(const JointTransformations& jointinfos, const KinematicChain& chains,
+		const int* sensor_dtform_idxs, const int* blockid_to_jointid_map,
+		const int* rendered_pixels, const float* rendered_points, const int* rendered_block_ids,
+		int width, int height, float focal_length_x, float focal_length_y, const Settings* settings) :
+		ComputeJacobianRow(jointinfos, chains),
+		sensor_dtform_idxs(sensor_dtform_idxs), blockid_to_jointid_map(blockid_to_jointid_map),
+		rendered_pixels(rendered_pixels), rendered_points(rendered_points), rendered_block_ids(rendered_block_ids),
+		width(width), height(height), focal_length_x(focal_length_x), focal_length_y(focal_length_y) {
+		this->weight = settings->fit2D_weight;
+	}
+
+	glm::mat3x2 projection_jacobian(const glm::vec3& pos) const {
+		glm::mat3x2 M(0); ///< remember column major!
+		M[0][0] = focal_length_x / pos[2];
+		M[1][1] = focal_length_y / pos[2];
+		M[2][0] = -pos[0] * focal_length_x / (pos[2] * pos[2]);
+		M[2][1] = -pos[1] * focal_length_y / (pos[2] * pos[2]);
+		return M;
+	}
+
+	void assemble_linear_system(int b, const glm::vec2& p_diff, const glm::vec3& p_rend_3D, SparseRow* J_sub, Scalar* e_sub) const {
+		int joint_id = blockid_to_jointid_map[b];
+		glm::mat3x2 J_proj = projection_jacobian(p_rend_3D);
+
+		///--- Compute LHS
+		int i_column = 0;
+		for (; i_column < CHAIN_MAX_LENGTH; i_column++) {
+			int jointinfo_id = chains[joint_id].data[i_column];
+			if (jointinfo_id == -1) break;
+			const CustomJointInfo& jinfo = jointinfos[jointinfo_id];
+			glm::vec2 jcol = J_proj * skeleton_column(jinfo, p_rend_3D);
+			J_sub[0].index[i_column] = J_sub[1].index[i_column] = jinfo.index;
+			J_sub[0].value[i_column] = weight * jcol.x;
+			J_sub[1].value[i_column] = weight * jcol.y;
+		}
+		J_sub[0].size = J_sub[1].size = i_column;
+
+		/// Fills RHS
+		e_sub[0] = weight * p_diff.x;
+		e_sub[1] = weight * p_diff.y;
+	}
+
+	/// @param index of the sample in Model::rendered_pixels (see Model::compute_rendered_indicator)
+	/// @param J_sub two jacobian rows
+	/// @param e_sub two residuals
+	void operator()(int index, SparseRow* J_sub, Scalar* e_sub) const {
+		glm::vec3 p_rend_3D(rendered_points[3 * index], rendered_points[3 * index + 1], rendered_points[3 * index + 2]);
+		int linear_index = rendered_pixels[index];
+		int block_id = rendered_block_ids[index];
+
+		int offset_y = linear_index / width;
+		int offset_x = linear_index - width * offset_y;
+		offset_y = height - 1 - offset_y;
+		int offset_z = offset_y * width + offset_x;
+
+		// Fetch closest point on sensor data
+		int closest_idx = sensor_dtform_idxs[offset_z];
+		int row = closest_idx / width;
+		int col = closest_idx - width * row;
+		glm::vec2 p_rend(offset_x, offset_y);
+		glm::vec2 p_sens(col, row);
+
+		assemble_linear_system(block_id, p_sens - p_rend, p_rend_3D, J_sub, e_sub);
+	}
+};
+
+} /// fitting::
+} /// energy::
@@ -0,0 +1,647 @@
+#pragma once
+#include "cudax/cuda_glm.h"
+#include "tracker/Types.h"
+#include <cstdlib> ///< RAND_MAX
+#include <vector>
+#include <algorithm>
+#include <cmath>
+
+/// @note host port of cudax/functors/CorrespondencesFinder.h, keep the two in sync.
+///       Raw buffers are the ones exposed by ModelSerializer (Model::host_pointer_*)
+namespace energy {
+namespace fitting {
+
+/// Number of sensor points projected together by CorrespondencesFinder::find_batch (one AVX2 register of floats)
+const int correspondences_batch_size = 8;
+
+struct CorrespondencesFinder {
+	const float * centers = NULL;
+	const float * radii = NULL;
+	const int * blocks = NULL;
+	const float * tangent_points = NULL;
+	const float * outline = NULL;
+
+	int num_centers = 0;
+	int num_blocks = 0;
+	int num_outlines = 0;
+	int num_tangent_fields = 8;
+	int num_outline_fields = 3;
+
+	/// Invariants of a convsegment block, they only depend on the pose (see update())
+	struct Convsegment {
+		glm::vec3 c1, c2, x;
+		float r1, r2, delta_r;
+		float length_x, length_x2, omega, x_dot_x;
+		int index1, index2;
+	};
+	std::vector<Convsegment> convsegments; ///< indexed by block, unused for convtriangle blocks
+	std::vector<glm::vec4> bounds; ///< bounding sphere (center, radius) of every block, see update()
+	std::vector<std::vector<int> > neighbours; ///< blocks sharing a sphere with each block, see update()
+
+	float myatan2(const glm::vec2 & v) const {
+		const float pi = 3.14159265358979f;
+		float alpha = std::atan2(v[1], v[0]);
+		if (alpha < 0) alpha = alpha + 2 * pi;
+		return alpha;
+	}
+
+	float sign(float a) const {
+		if (a >= 0) return 1.0;
+		else return -1.0;
+	}
+
+	int index_size(const glm::ivec3 & index) const {
+		if (index[1] > num_centers) return 1;
+		if (index[2] > num_centers) return 2;
+		return 3;
+	}
+
+	glm::vec3 center(int i) const { return glm::vec3(centers[d * i], centers[d * i + 1], centers[d * i + 2]); }
+
+	glm::vec3 tangent_field(int j, int k) const {
+		const float * t = tangent_points + num_tangent_fields * d * j + d * k;
+		return glm::vec3(t[0], t[1], t[2]);
+	}
+
+	bool is_point_on_segment(const glm::vec3 & p, const glm::vec3 & a, const glm::vec3 & b) const {
+		float alpha = glm::dot(b - a, p - a);
+		if (alpha < 0) return false;
+		if (alpha > glm::dot(b - a, b - a)) return false;
+		return true;
+	}
+
+	bool is_point_in_triangle(const glm::vec3 & p, const glm::vec3 & a, const glm::vec3 & b, const glm::vec3 & c) const {
+		glm::vec3 v0 = b - a;
+		glm::vec3 v1 = c - a;
+		glm::vec3 v2 = p - a;
+		float d00 = glm::dot(v0, v0);
+		float d01 = glm::dot(v0, v1);
+		float d11 = glm::dot(v1, v1);
+		float d20 = glm::dot(v2, v0);
+		float d21 = glm::dot(v2, v1);
+		float denom = d00 * d11 - d01 * d01;
+		float alpha = (d11 * d20 - d01 * d21) / denom;
+		float beta = (d00 * d21 - d01 * d20) / denom;
+		float gamma = 1.0f - alpha - beta;
+		if (alpha >= 0 && alpha <= 1 && beta >= 0 && beta <= 1 && gamma >= 0 && gamma <= 1) return true;
+		else return false;
+	}
+
+	bool is_point_on_arc(const glm::vec2 & c, const glm::vec2 & p, const glm::vec2 & q, const glm::vec2 & t) const {
+		const float pi = 3.14159265358979f;
+		float alpha = myatan2(p - c);
+		float beta = myatan2(q - c);
+		float gamma = myatan2(t - c);
+
+		if (beta < alpha) beta = beta + 2 * pi;
+		if (gamma < alpha) gamma = gamma + 2 * pi;
+		if (gamma < beta) return true;
+		else return false;
+	}
+
+	glm::vec3 projection_plane(const glm::vec3 & p, const glm::vec3 & p0, const glm::vec3 & n) const {
+		float distance = glm::dot(p - p0, n);
+		return p - n * distance;
+	}
+
+	glm::vec3 projection_arc(const glm::vec3 & p, const glm::vec3 & c, float r, const glm::vec3 & n, const glm::vec3 & t1, const glm::vec3 & t2) const {
+		glm::vec3 s = projection_plane(p, c, n);
+		glm::vec3 q = c + r * (s - c) / glm::length(s - c);
+
+		// asume that arc is in xy plane(this is always the case in our system)
+		if (!is_point_on_arc(glm::vec2(c[0], c[1]), glm::vec2(t1[0], t1[1]), glm::vec2(t2[0], t2[1]), glm::vec2(q[0], q[1]))) {
+			float d1 = glm::length(p - t1);
+			float d2 = glm::length(p - t2);
+			if (d1 < d2) q = t1;
+			else q = t2;
+		}
+		return q;
+	}
+
+	glm::vec3 projection_segment(const glm::vec3 & p, const glm::vec3 & a, const glm::vec3 & b) const {
+		glm::vec3 u = b - a;
+		glm::vec3 v = p - a;
+		float alpha = glm::dot(u, v) / glm::dot(u, u);
+		if (alpha <= 0) return a;
+		if (alpha > 0 && alpha < 1) return a + alpha * u;
+		return b;
+	}
+
+	void projection_segment(const glm::vec3 & p, const glm::vec3 & a, const glm::vec3 & b, int index1, int index2, glm::vec3 & q, glm::ivec3 & index) const {
+		glm::vec3 u = b - a;
+		glm::vec3 v = p - a;
+		float alpha = glm::dot(u, v) / glm::dot(u, u);
+		if (alpha <= 0) {
+			q = a;
+			index = glm::ivec3(index1, RAND_MAX, RAND_MAX);
+		}
+		if (alpha > 0 && alpha < 1) {
+			q = a + alpha * u;
+			index = glm::ivec3(index1, index2, RAND_MAX);
+		}
+		if (alpha >= 1) {
+			q = b;
+			index = glm::ivec3(index2, RAND_MAX, RAND_MAX);
+		}
+	}
+
+	void projection_segments(const glm::vec3 & p, const glm::vec3 & v1, const glm::vec3 & v2, const glm::vec3 & v3, int index1, int index2, int index3,
+		glm::vec3 & q, glm::ivec3 & index) const {
+		glm::vec3 q12; glm::ivec3 index12; projection_segment(p, v1, v2, index1, index2, q12, index12);
+		glm::vec3 q13; glm::ivec3 index13; projection_segment(p, v1, v3, index1, index3, q13, index13);
+		glm::vec3 q23; glm::ivec3 index23; projection_segment(p, v2, v3, index2, index3, q23, index23);
+		float d12 = glm::length(p - q12);
+		float d13 = glm::length(p - q13);
+		float d23 = glm::length(p - q23);
+		if (d12 <= d13 && d12 <= d23) {
+			q = q12;
+			index = index12;
+		}
+		if (d13 <= d12 && d13 <= d23) {
+			q = q13;
+			index = index13;
+		}
+		if (d23 <= d12 && d23 <= d13) {
+			q = q23;
+			index = index23;
+		}
+	}
+
+	void projection_convsegment(const glm::vec3 & p, const glm::vec3 & c1, const glm::vec3 & c2, float r1, float r2, int index1, int index2,
+		glm::vec3 & q, glm::vec3 & s, glm::ivec3 & index) const {
+
+		glm::vec3 x = c2 - c1;
+		float delta_r = r1 - r2;
+		float length_x = glm::length(x);
+		float length_x2 = length_x * length_x;
+
+		float alpha = glm::dot(x, p - c1) / length_x2;
+		glm::vec3 t = c1 + alpha * x;
+		float omega = std::sqrt(length_x2 - delta_r * delta_r);
+		float beta = glm::length(p - t) * delta_r / omega;
+		s = t - beta * x / length_x;
+
+		if (is_point_on_segment(s, c1, c2)) {
+			float gamma = delta_r * glm::length(c2 - t + beta * x / length_x) / length_x;
+			q = s + (p - s) / glm::length(p - s) * (gamma + r2);
+			index = glm::ivec3(index1, index2, RAND_MAX);
+		}
+		else {
+			glm::vec3 q1 = c1 + r1 * (p - c1) / glm::length(p - c1);
+			glm::vec3 q2 = c2 + r2 * (p - c2) / glm::length(p - c2);
+
+			if (sign(glm::length(p - c1) - glm::length(q1 - c1)) * glm::length(p - q1) < sign(glm::length(p - c2) - glm::length(q2 - c2)) * glm::length(p - q2)) {
+				s = c1;
+				q = q1;
+				index = glm::ivec3(index1, RAND_MAX, RAND_MAX);
+			}
+			else {
+				s = c2;
+				q = q2;
+				index = glm::ivec3(index2, RAND_MAX, RAND_MAX);
+			}
+		}
+	}
+
+	void projection_convtriangle(const glm::vec3 & p, const glm::vec3 & c1, const glm::vec3 & c2, const glm::vec3 & c3,
+		float r1, float r2, float r3, int index1, int index2, int index3,
+		const glm::vec3 & v1, const glm::vec3 & n, const glm::vec3 & u1, const glm::vec3 & m, const glm::vec3 & camera_ray,
+		glm::vec3 & q, glm::vec3 & s, glm::ivec3 & index) const {
+
+		// project on triangle
+		glm::vec3 l = glm::normalize(glm::cross(c2 - c1, c3 - c1));
+		index = glm::ivec3(index1, index2, index3);
+
+		glm::vec3 s1, s2, q1, q2;
+		float cos_alpha, distance;
+		bool f1 = false; bool f2 = false;
+
+		if (glm::dot(n, camera_ray) < 0) {
+			if (glm::dot(l, n) < 0) l = -l;
+			cos_alpha = glm::dot(l, n);
+			distance = glm::dot(p - c1, l) / cos_alpha;
+			s1 = p - n * distance;
+			if (is_point_in_triangle(s1, c1, c2, c3)) {
+				f1 = true;
+				distance = glm::dot(p - v1, n);
+				q1 = p - n * distance;
+			}
+		}
+		if (glm::dot(m, camera_ray) < 0) {
+			if (glm::dot(l, m) < 0) l = -l;
+			cos_alpha = glm::dot(l, m);
+			distance = glm::dot(p - c1, l) / cos_alpha;
+			s2 = p - m * distance;
+			if (is_point_in_triangle(s2, c1, c2, c3)) {
+				f2 = true;
+				distance = glm::dot(p - u1, m);
+				q2 = p - m * distance;
+			}
+		}
+
+		if (f1 && f2) {
+			if (glm::length(p - q1) < glm::length(p - q2)) { q = q1; s = s1; }
+			else { q = q2; s = s2; } return;
+		}
+		if (f1 && !f2) { q = q1; s = s1; return; }
+		if (f2 && !f1) { q = q2; s = s2; return; }
+
+		// project on convsegments
+		glm::vec3 q12; glm::vec3 s12; glm::ivec3 index12;
+		projection_convsegment(p, c1, c2, r1, r2, index1, index2, q12, s12, index12);
+		glm::vec3 q13; glm::vec3 s13; glm::ivec3 index13;
+		projection_convsegment(p, c1, c3, r1, r3, index1, index3, q13, s13, index13);
+		glm::vec3 q23; glm::vec3 s23; glm::ivec3 index23;
+		projection_convsegment(p, c2, c3, r2, r3, index2, index3, q23, s23, index23);
+
+		float d12 = sign(glm::length(p - s12) - glm::length(q12 - s12)) * glm::length(p - q12);
+		float d13 = sign(glm::length(p - s13) - glm::length(q13 - s13)) * glm::length(p - q13);
+		float d23 = sign(glm::length(p - s23) - glm::length(q23 - s23)) * glm::length(p - q23);
+
+		// supress sphere projections corresponding to non - existing surface
+		if (index_size(index12) == 1 &&
+			(index_size(index23) == 2 || index12[0] != index23[0]) &&
+			(index_size(index13) == 2 || index12[0] != index13[0]))
+			d12 = RAND_MAX;
+		if (index_size(index13) == 1 &&
+			(index_size(index12) == 2 || index13[0] != index12[0]) &&
+			(index_size(index23) == 2 || index13[0] != index23[0]))
+			d13 = RAND_MAX;
+		if (index_size(index23) == 1 &&
+			(index_size(index12) == 2 || index23[0] != index12[0]) &&
+			(index_size(index13) == 2 || index23[0] != index13[0]))
+			d23 = RAND_MAX;
+
+		if (d12 <= d13 && d12 <= d23) {
+			s = s12; q = q12; index = index12;
+		}
+		if (d13 <= d12 && d13 <= d23) {
+			s = s13; q = q13; index = index13;
+		}
+		if (d23 <= d12 && d23 <= d13) {
+			s = s23; q = q23; index = index23;
+		}
+	}
+
+	/// Projection of p on block j
+	/// @return signed distance of p to the block surface
+	float projection_block(const glm::vec3 & p, const glm::vec3 & camera_ray, int j, glm::vec3 & q, glm::vec3 & s, glm::ivec3 & index) const {
+		if (blocks[d * j + 2] > num_centers) {
+			int index1 = blocks[d * j];
+			int index2 = blocks[d * j + 1];
+			projection_convsegment(p, center(index1), center(index2), radii[index1], radii[index2], index1, index2, q, s, index);
+		}
+		else {
+			int index1 = blocks[d * j];
+			int index2 = blocks[d * j + 1];
+			int index3 = blocks[d * j + 2];
+			projection_convtriangle(p, center(index1), center(index2), center(index3), radii[index1], radii[index2], radii[index3], index1, index2, index3,
+				tangent_field(j, 0), tangent_field(j, 3), tangent_field(j, 4), tangent_field(j, 7), camera_ray, q, s, index);
+		}
+		return sign(glm::length(p - s) - glm::length(q - s)) * glm::length(p - q);
+	}
+
+	/// Lower bound of projection_block(p, ..., j, ...), valid once update() has been called
+	float lower_bound(const glm::vec3 & p, int j) const {
+		return glm::length(p - glm::vec3(bounds[j])) - bounds[j][3];
+	}
+
+	/// Broad phase: the block with the closest bounding sphere gives an upper bound on the
+	/// distance of p to the model, blocks whose lower bound exceeds it cannot win in projection
+	/// @param hint block p was assigned to at the previous iteration (or -1), the hint and its
+	///        neighbours are tried instead of the closest bounding sphere
+	/// @return distance to the closest of the blocks it projected p on (j_cutoff, ties to the lowest as in
+	///         projection), the initial minimum of projection which does not project them again
+	float cutoff_distance(const glm::vec3 & p, const glm::vec3 & camera_ray, int hint, int & j_cutoff, glm::vec3 & q, glm::vec3 & s, glm::ivec3 & index) const {
+		if (hint >= 0 && hint < num_blocks) {
+			j_cutoff = hint;
+			float cutoff = projection_block(p, camera_ray, hint, q, s, index);
+			for (size_t k = 0; k < neighbours[hint].size(); k++) {
+				int j = neighbours[hint][k];
+				glm::vec3 q_j, s_j; glm::ivec3 index_j;
+				float distance = projection_block(p, camera_ray, j, q_j, s_j, index_j);
+				if (distance < cutoff || std::isnan(cutoff) || (distance == cutoff && j < j_cutoff)) {
+					cutoff = distance;
+					j_cutoff = j; q = q_j; s = s_j; index = index_j;
+				}
+			}
+			return cutoff;
+		}
+
+		j_cutoff = 0;
+		float min_lower_bound = RAND_MAX;
+		for (int j = 0; j < num_blocks; j++) {
+			float lb = lower_bound(p, j);
+			if (lb < min_lower_bound) {
+				min_lower_bound = lb;
+				j_cutoff = j;
+			}
+		}
+		return projection_block(p, camera_ray, j_cutoff, q, s, index);
+	}
+
+	/// Whether cutoff_distance(p, camera_ray, hint, j_cutoff, ...) projected p on block j
+	bool projected_by_cutoff(int j, int hint, int j_cutoff) const {
+		if (j == j_cutoff) return true;
+		if (hint < 0 || hint >= num_blocks) return false;
+		return j == hint || std::binary_search(neighbours[hint].begin(), neighbours[hint].end(), j); ///< sorted, see update()
+	}
+
+	void projection(const glm::vec3 & p, const glm::vec3 & camera_ray, int & min_j, glm::vec3 & min_q, glm::vec3 & min_s, glm::ivec3 & min_index, int hint = -1) const {
+		glm::vec3 q;
+		glm::vec3 s;
+		glm::ivec3 index;
+
+		int j_cutoff;
+		glm::vec3 q_cutoff, s_cutoff;
+		glm::ivec3 index_cutoff;
+		float cutoff = cutoff_distance(p, camera_ray, hint, j_cutoff, q_cutoff, s_cutoff, index_cutoff);
+
+		float distance;
+		float min_distance = RAND_MAX;
+		for (int j = 0; j < num_blocks; j++) {
+			if (j == j_cutoff) {
+				q = q_cutoff; s = s_cutoff; index = index_cutoff;
+				distance = cutoff;
+			}
+			else {
+				if (projected_by_cutoff(j, hint, j_cutoff)) continue; ///< not closer than j_cutoff
+				if (lower_bound(p, j) > cutoff) continue; ///< never true if cutoff is nan
+				distance = projection_block(p, camera_ray, j, q, s, index);
+			}
+			if (distance < min_distance) {
+				min_s = s;
+				min_q = q;
+				min_index = index;
+				min_distance = distance;
+				min_j = j;
+			}
+		}
+	}
+
+	void backfacing(const glm::vec3 & p, const glm::vec3 & camera_ray, int & min_j, glm::vec3 & min_q, glm::vec3 & min_s, glm::ivec3 & min_index) const {
+		if (glm::dot(camera_ray, min_q - min_s) < 0)  return;
+		if (blocks[d * min_j + 2] < num_centers) {
+			bool f1 = false;
+			bool f2 = false;
+			glm::vec3 q1, q2; glm::ivec3 index1, index2;
+			const int * block = blocks + d * min_j;
+			if (glm::dot(tangent_field(min_j, 3), camera_ray) < 0) {
+				f1 = true;
+				projection_segments(p, tangent_field(min_j, 0), tangent_field(min_j, 1), tangent_field(min_j, 2), block[0], block[1], block[2], q1, index1);
+			}
+			if (glm::dot(tangent_field(min_j, 7), camera_ray) < 0) {
+				f2 = true;
+				projection_segments(p, tangent_field(min_j, 4), tangent_field(min_j, 5), tangent_field(min_j, 6), block[0], block[1], block[2], q2, index2);
+			}
+			if (f1 && f2) {
+				if (glm::length(p - q1) < glm::length(p - q2)) { min_q = q1; min_index = index1; }
+				else { min_q = q2; min_index = index2; }
+			}
+			if (f1 && !f2) { min_q = q1; min_index = index1; }
+			if (f2 && !f1) { min_q = q2; min_index = index2; }
+			if (!f1 && !f2) { min_q = glm::vec3(RAND_MAX, RAND_MAX, RAND_MAX); }
+		}
+		else {
+			min_q = glm::vec3(RAND_MAX, RAND_MAX, RAND_MAX);
+		}
+	}
+
+	void projection_outline(const glm::vec3 & p, const glm::vec3 & camera_ray, int & min_j, glm::vec3 & min_q, glm::vec3 & min_s, glm::ivec3 & min_index) const {
+		const int shift_indices = 6;
+		const int shift_start = 0;
+		const int shift_end = 3;
+		const int shift_block = 8;
+
+		float min_distance = RAND_MAX;
+		glm::vec3 t1, t2, c1, c2, q, s, temp_c; float r1, r2, temp_r; int index1, index2; glm::ivec3 temp_index;
+		for (int j = 0; j < num_outlines; j++) {
+			const float * segment = outline + d * num_outline_fields * j;
+			index1 = segment[shift_indices];
+			index2 = segment[shift_indices + 1];
+			t1 = glm::vec3(segment[shift_start], segment[shift_start + 1], segment[shift_start + 2]);
+			t2 = glm::vec3(segment[shift_end], segment[shift_end + 1], segment[shift_end + 2]);
+
+			if (segment[shift_indices + 1] == RAND_MAX) {
+				c1 = center(index1);
+				r1 = radii[index1];
+				q = projection_arc(p, c1, r1, camera_ray, t1, t2);
+				s = c1;
+			}
+			else {
+				q = projection_segment(p, t1, t2);
+
+				c1 = center(index1);
+				c2 = center(index2);
+				r1 = radii[index1];
+				r2 = radii[index2];
+				if (r2 > r1) {
+					temp_c = c1; c1 = c2; c2 = temp_c;
+					temp_r = r1; r1 = r2; r2 = temp_r;
+				}
+				projection_convsegment(q, c1, c2, r1, r2, index1, index2, temp_c, s, temp_index);
+			}
+			if (glm::length(p - q) < min_distance) {
+				min_distance = glm::length(p - q);
+				min_q = q;
+				min_index = glm::ivec3(segment[shift_indices], segment[shift_indices + 1], RAND_MAX);
+				min_s = s;
+				min_j = segment[shift_block];
+			}
+		}
+	}
+
+	/// Backfacing and outline tests following the projection on the blocks
+	void find_outline(const glm::vec3 & p, int & b, glm::vec3 & q, glm::vec3 & s, glm::ivec3 & index) const {
+		glm::vec3 q_o = glm::vec3(RAND_MAX, RAND_MAX, RAND_MAX); ///< no outline yet
+		glm::vec3 s_o;
+		glm::ivec3 index_o;
+		int b_o = 0;
+		glm::vec3 camera_ray = glm::vec3(0, 0, 1);
+		backfacing(p, camera_ray, b, q, s, index);
+		projection_outline(p, camera_ray, b_o, q_o, s_o, index_o);
+		if (glm::length(p - q_o) < glm::length(p - q)) {
+			q = q_o;
+			index = index_o;
+			s = s_o;
+			b = b_o;
+		}
+	}
+
+	/// Closest point q on the model surface to p, s is its projection on the skeleton and b the block it belongs to
+	/// @param hint optional block of p at the previous iteration, only used to speed up the search
+	void find(const glm::vec3 & p, int & b, glm::vec3 & q, glm::vec3 & s, glm::ivec3 & index, int hint = -1) const {
+		glm::vec3 camera_ray = glm::vec3(0, 0, 1);
+		projection(p, camera_ray, b, q, s, index, hint);
+		find_outline(p, b, q, s, index);
+	}
+
+	/// Precomputes the block bounds and the convsegment invariants, call after the raw buffers change
+	void update() {
+		convsegments.resize(num_blocks);
+		bounds.resize(num_blocks);
+		neighbours.resize(num_blocks);
+		for (int j = 0; j < num_blocks; j++) {
+			///--- Topological neighbours
+			neighbours[j].clear();
+			for (int i = 0; i < num_blocks; i++) {
+				if (i == j) continue;
+				bool shared = false;
+				for (int k = 0; k < d; k++)
+					for (int h = 0; h < d; h++)
+						shared = shared || (blocks[d * j + k] <= num_centers && blocks[d * j + k] == blocks[d * i + h]);
+				if (shared) neighbours[j].push_back(i);
+			}
+
+			///--- Bounding sphere, covers the spheres of the block and its tangent triangles (fields 0-2 and 4-6)
+			int size = blocks[d * j + 2] > num_centers ? 2 : 3;
+			glm::vec3 bound_center(0);
+			for (int k = 0; k < size; k++) bound_center += center(blocks[d * j + k]);
+			bound_center /= (float) size;
+			float bound_radius = 0;
+			for (int k = 0; k < size; k++)
+				bound_radius = std::max(bound_radius, glm::length(center(blocks[d * j + k]) - bound_center) + radii[blocks[d * j + k]]);
+			if (size == 3) {
+				for (int k = 0; k < 7; k++) {
+					if (k == 3) continue; ///< normal
+					bound_radius = std::max(bound_radius, glm::length(tangent_field(j, k) - bound_center));
+				}
+			}
+			bounds[j] = glm::vec4(bound_center, bound_radius);
+
+			if (size == 3) continue;
+			Convsegment & c = convsegments[j];
+			c.index1 = blocks[d * j];
+			c.index2 = blocks[d * j + 1];
+			c.c1 = center(c.index1);
+			c.c2 = center(c.index2);
+			c.r1 = radii[c.index1];
+			c.r2 = radii[c.index2];
+			c.x = c.c2 - c.c1;
+			c.delta_r = c.r1 - c.r2;
+			c.length_x = glm::length(c.x);
+			c.length_x2 = c.length_x * c.length_x;
+			c.omega = std::sqrt(c.length_x2 - c.delta_r * c.delta_r);
+			c.x_dot_x = glm::dot(c.x, c.x);
+		}
+	}
+
+	/// Same as find, for up to correspondences_batch_size points at once (hint can be NULL). Points are kept in a
+	/// structure of arrays and every convsegment block is evaluated branch-free across the batch,
+	/// the loops over the lanes are the ones meant to be vectorized. Convtriangle blocks (palm)
+	/// and the outline are still processed one point at a time.
+	void find_batch(const glm::vec3 * p, int n, const int * hint, int * b, glm::vec3 * q, glm::vec3 * s, glm::ivec3 * index) const {
+		const int N = correspondences_batch_size;
+		float px[N], py[N], pz[N];
+		float min_distance[N];
+		int min_j[N];
+		float qx[N], qy[N], qz[N];
+		float sx[N], sy[N], sz[N];
+		int i0[N], i1[N], i2[N];
+
+		for (int l = 0; l < N; l++) {
+			const glm::vec3 & p_l = p[l < n ? l : 0]; ///< pad with the first point
+			px[l] = p_l[0]; py[l] = p_l[1]; pz[l] = p_l[2];
+			min_distance[l] = RAND_MAX;
+			min_j[l] = 0;
+		}
+
+		///--- The closest of the blocks projected by cutoff_distance is the initial minimum, as in projection
+		glm::vec3 camera_ray = glm::vec3(0, 0, 1);
+		float cutoff[N];
+		int hints[N], j_cutoff[N];
+		for (int l = 0; l < n; l++) {
+			hints[l] = hint ? hint[l] : -1;
+			glm::vec3 q_l, s_l; glm::ivec3 index_l;
+			cutoff[l] = cutoff_distance(p[l], camera_ray, hints[l], j_cutoff[l], q_l, s_l, index_l);
+			min_distance[l] = std::isnan(cutoff[l]) ? RAND_MAX : cutoff[l]; ///< a nan distance never wins in projection either
+			min_j[l] = j_cutoff[l];
+			qx[l] = q_l[0]; qy[l] = q_l[1]; qz[l] = q_l[2];
+			sx[l] = s_l[0]; sy[l] = s_l[1]; sz[l] = s_l[2];
+			i0[l] = index_l[0]; i1[l] = index_l[1]; i2[l] = index_l[2];
+		}
+
+		bool skip[N]; ///< lanes for which the block cannot be the closest or was already projected
+		for (int j = 0; j < num_blocks; j++) {
+			///--- Skip the block if it cannot be the closest for any point of the batch
+			bool candidate = false;
+			for (int l = 0; l < N; l++) {
+				skip[l] = l >= n || projected_by_cutoff(j, hints[l], j_cutoff[l]) || lower_bound(p[l], j) > cutoff[l];
+				candidate = candidate || !skip[l];
+			}
+			if (!candidate) continue;
+
+			if (blocks[d * j + 2] > num_centers) {
+				const Convsegment & c = convsegments[j];
+				#pragma omp simd
+				for (int l = 0; l < N; l++) {
+					glm::vec3 p_l(px[l], py[l], pz[l]);
+
+					///--- projection_convsegment
+					float alpha = glm::dot(c.x, p_l - c.c1) / c.length_x2;
+					glm::vec3 t = c.c1 + alpha * c.x;
+					float beta = glm::length(p_l - t) * c.delta_r / c.omega;
+					glm::vec3 s_l = t - beta * c.x / c.length_x;
+					float a = glm::dot(c.x, s_l - c.c1);
+					bool on_segment = !(a < 0) && !(a > c.x_dot_x);
+
+					float gamma = c.delta_r * glm::length(c.c2 - t + beta * c.x / c.length_x) / c.length_x;
+					glm::vec3 q_l = s_l + (p_l - s_l) / glm::length(p_l - s_l) * (gamma + c.r2);
+					glm::vec3 q1 = c.c1 + c.r1 * (p_l - c.c1) / glm::length(p_l - c.c1);
+					glm::vec3 q2 = c.c2 + c.r2 * (p_l - c.c2) / glm::length(p_l - c.c2);
+					bool first = sign(glm::length(p_l - c.c1) - glm::length(q1 - c.c1)) * glm::length(p_l - q1) <
+						sign(glm::length(p_l - c.c2) - glm::length(q2 - c.c2)) * glm::length(p_l - q2);
+					if (!on_segment) {
+						s_l = first ? c.c1 : c.c2;
+						q_l = first ? q1 : q2;
+					}
+
+					///--- keep the closest block, ties to the lowest as in projection
+					float distance = sign(glm::length(p_l - s_l) - glm::length(q_l - s_l)) * glm::length(p_l - q_l);
+					if (!skip[l] && (distance < min_distance[l] || (distance == min_distance[l] && j < min_j[l]))) {
+						min_distance[l] = distance;
+						min_j[l] = j;
+						qx[l] = q_l[0]; qy[l] = q_l[1]; qz[l] = q_l[2];
+						sx[l] = s_l[0]; sy[l] = s_l[1]; sz[l] = s_l[2];
+						i0[l] = on_segment || first ? c.index1 : c.index2;
+						i1[l] = on_segment ? c.index2 : RAND_MAX;
+						i2[l] = RAND_MAX;
+					}
+				}
+			}
+			else {
+				int index1 = blocks[d * j];
+				int index2 = blocks[d * j + 1];
+				int index3 = blocks[d * j + 2];
+				glm::vec3 c1 = center(index1), c2 = center(index2), c3 = center(index3);
+				glm::vec3 v1 = tangent_field(j, 0), n1 = tangent_field(j, 3), u1 = tangent_field(j, 4), m1 = tangent_field(j, 7);
+				for (int l = 0; l < n; l++) {
+					if (skip[l]) continue;
+					glm::vec3 p_l(px[l], py[l], pz[l]);
+					glm::vec3 q_l, s_l; glm::ivec3 index_l;
+					projection_convtriangle(p_l, c1, c2, c3, radii[index1], radii[index2], radii[index3], index1, index2, index3,
+						v1, n1, u1, m1, camera_ray, q_l, s_l, index_l);
+					float distance = sign(glm::length(p_l - s_l) - glm::length(q_l - s_l)) * glm::length(p_l - q_l);
+					if (distance < min_distance[l] || (distance == min_distance[l] && j < min_j[l])) {
+						min_distance[l] = distance;
+						min_j[l] = j;
+						qx[l] = q_l[0]; qy[l] = q_l[1]; qz[l] = q_l[2];
+						sx[l] = s_l[0]; sy[l] = s_l[1]; sz[l] = s_l[2];
+						i0[l] = index_l[0]; i1[l] = index_l[1]; i2[l] = index_l[2];
+					}
+				}
+			}
+		}
+
+		for (int l = 0; l < n; l++) {
+			b[l] = min_j[l];
+			q[l] = glm::vec3(qx[l], qy[l], qz[l]);
+			s[l] = glm::vec3(sx[l], sy[l], sz[l]);
+			index[l] = glm::ivec3(i0[l], i1[l], i2[l]);
+			find_outline(p[l], b[l], q[l], s[l], index[l]);
+		}
+	}
+};
+
+} /// fitting::
+} /// energy::
@@ -1,4 +1,5 @@
 #pragma once
+#include <algorithm>
 #ifdef WITH_OPENCV
     #include "opencv2/core/core.hpp"    
 #endif
@@ -11,17 +12,24 @@ private:
     float* z=NULL;
     float* DTTps=NULL;
     int* ADTTps=NULL;
+    float* DTTps_t=NULL;  ///< DTTps transposed (column major), for the column pass
+    int* ADTTps_t=NULL;
+    int* realADT_t=NULL;
     float* realDT=NULL;
     int* realADT=NULL; ///< stores closest point ids (float just to simplify CUDA)
+    static const int tile = 32; ///< side of the blocks of the transposes
     
 public:
     void init(int width, int height){
         this->width = width;
         this->height = height;
         v = new float[width*height];
-        z = new float[width*height];
+        z = new float[width*height + 1]; ///< the last envelope writes one past its row
         DTTps = new float[width*height];
         ADTTps = new int[width*height];
+        DTTps_t = new float[width*height];
+        ADTTps_t = new int[width*height];
+        realADT_t = new int[width*height];
         realADT = new int[width*height];
         realDT = new float[width*height];
     }
@@ -30,6 +38,9 @@ public:
         delete[] z;
         delete[] DTTps;
         delete[] ADTTps;
+        delete[] DTTps_t;
+        delete[] ADTTps_t;
+        delete[] realADT_t;
         delete[] realADT;
         delete[] realDT;        
     }
@@ -42,15 +53,112 @@ public:
     int dst_at(int row, int col){ return realDT[row*width+col]; }
     int idx_at(int row, int col){ return realADT[row*width+col]; }
 #endif
+
+private:
+    /// Lower envelope of the parabolas rooted at f[first..last] (stride apart), evaluated at the n samples of
+    /// the line. Pixels outside [first, last] hold FLT_MAX: they would enter the envelope only to be popped
+    /// by the next data pixel, so leaving them out gives the same result.
+    /// @note v, z hold the envelope of the line, from offset
+    template<class Output>
+    void envelope(const float* f, int stride, int first, int last, int n, unsigned int offset, Output output)
+    {
+        unsigned int k = 0;
+        v[offset] = first;
+        z[offset] = FLT_MIN;
+        z[offset + 1] = FLT_MAX;
+        for(int q = first+1; q<=last; ++q)
+        {
+            float sp1 = float(f[q*stride] + (q*q));
+            unsigned int index2 = offset + k;
+            unsigned int vk = v[index2];
+            float s = (sp1 - float(f[vk*stride] + (vk*vk)))/float((q-vk) << 1);
+            while(s <= z[index2] && k > 0)
+            {
+                k--;
+                index2 = offset + k;
+                vk = v[index2];
+                s = (sp1 - float(f[vk*stride] + (vk*vk)))/float((q-vk) << 1);
+            }
+            k++;
+            index2 = offset + k;
+            v[index2] = q;
+            z[index2] = s;
+            z[index2+1] = FLT_MAX;
+        }
+        k = 0;
+        for(int q = 0; q<n; ++q)
+        {
+            while(z[offset + k+1]<q)
+                k++;
+            output(q, (unsigned int)v[offset + k]);
+        }
+    }
+
+    /// out[c*rows + r] = in[r*cols + c] for the rows [row_begin, row_end) of in, in tiles
+    template<class T>
+    static void transpose(const T* in, T* out, int rows, int cols, int row_begin, int row_end)
+    {
+        int num_tiles_cols = (cols + tile - 1) / tile;
+        int num_tiles = ((row_end - row_begin + tile - 1) / tile) * num_tiles_cols;
+        #pragma omp for
+        for(int t = 0; t < num_tiles; ++t)
+        {
+            int r0 = row_begin + (t / num_tiles_cols) * tile;
+            int c0 = (t % num_tiles_cols) * tile;
+            int r1 = std::min(r0 + tile, row_end);
+            int c1 = std::min(c0 + tile, cols);
+            for(int c = c0; c < c1; ++c)
+                for(int r = r0; r < r1; ++r)
+                    out[c*rows + r] = in[r*cols + c];
+        }
+    }
+
+    struct RowOutput {
+        DistanceTransform* dt; unsigned int indexpt1; const float* f;
+        void operator()(int q, unsigned int vk) const {
+            float tp1 = float(q) - float(vk);
+            dt->DTTps[indexpt1 + q] = tp1*tp1 + f[vk];
+            dt->ADTTps[indexpt1 + q] = indexpt1 + vk;
+        }
+    };
+
+    struct ColumnOutput {
+        DistanceTransform* dt; int col; unsigned int indexpt1;
+        void operator()(int row, unsigned int vk) const {
+            #ifdef ENABLE_DTFORM_DSTS
+                /// Also compute the distance value
+                float tp1 =  float(row) - float(vk);
+                dt->realDT[col + row*dt->width] = sqrtf(tp1*tp1 + dt->DTTps_t[indexpt1 + vk]);
+            #endif
+            dt->realADT_t[indexpt1 + row] = dt->ADTTps_t[indexpt1 + vk];
+        }
+    };
     
 public:
     /// @pars row major uchar binary image. White pixels are "data" and 
     /// label_image[i] > mask_th decides what data is.
+    /// @note rows are split across threads; both passes only build their envelopes over the bounding
+    ///       box of the data, the output still covers the whole image
     void exec(unsigned char* label_image, int mask_th=125)
     {
-//        #pragma omp parallel
+        ///--- Bounding box of the data, the whole image if there is none (keeps the output of an empty image)
+        int row_min = height, row_max = -1, col_min = width, col_max = -1;
+        for(int row = 0; row < height; ++row)
+        {
+            const unsigned char* line = label_image + row*width;
+            int first = 0;
+            while(first < width && line[first] < mask_th) ++first;
+            if(first == width) continue;
+            int last = width - 1;
+            while(line[last] < mask_th) --last;
+            row_min = std::min(row_min, row); row_max = row;
+            col_min = std::min(col_min, first); col_max = std::max(col_max, last);
+        }
+        if(row_max < 0) { row_min = 0; row_max = height-1; col_min = 0; col_max = width-1; }
+
+        #pragma omp parallel
         {
-//            #pragma omp for
+            #pragma omp for
             for(int i = 0; i < width*height; ++i)
             {
                 if(label_image[i]<mask_th)
@@ -63,92 +171,27 @@ public:
             /// DT and ADT
             /////////////////////////////////////////////////////////////////
 
-            //First PASS (rows)
-//            #pragma omp for
-            for(int row = 0; row<height; ++row)
+            //First PASS (rows), only the rows of the bounding box are read by the second
+            #pragma omp for
+            for(int row = row_min; row<=row_max; ++row)
             {
-                unsigned int k = 0;
                 unsigned int indexpt1 = row*width;
-                v[indexpt1] = 0;
-                z[indexpt1] = FLT_MIN;
-                z[indexpt1 + 1] = FLT_MAX;
-                for(int q = 1; q<width; ++q)
-                {
-                    float sp1 = float(realDT[(indexpt1 + q)] + (q*q));
-                    unsigned int index2 = indexpt1 + k;
-                    unsigned int vk = v[index2];
-                    float s = (sp1 - float(realDT[(indexpt1 + vk)] + (vk*vk)))/float((q-vk) << 1);
-                    while(s <= z[index2] && k > 0)
-                    {
-                        k--;
-                        index2 = indexpt1 + k;
-                        vk = v[index2];
-                        s = (sp1 - float(realDT[(indexpt1 + vk)] + (vk*vk)))/float((q-vk) << 1);
-                    }
-                    k++;
-                    index2 = indexpt1 + k;
-                    v[index2] = q;
-                    z[index2] = s;
-                    z[index2+1] = FLT_MAX;
-                }
-                k = 0;
-                for(int q = 0; q<width; ++q)
-                {
-                    while(z[indexpt1 + k+1]<q)
-                        k++;
-                    unsigned int index2 = indexpt1 + k;
-                    unsigned int vk = v[index2];
-                    float tp1 =  float(q) - float(vk);
-                    DTTps[indexpt1 + q] = tp1*tp1 + float(realDT[(indexpt1 + vk)]);
-                    ADTTps[indexpt1 + q] = indexpt1 + vk;
-                }
+                RowOutput output = { this, indexpt1, realDT + indexpt1 };
+                envelope(realDT + indexpt1, 1, col_min, col_max, width, indexpt1, output);
             }
 
-            //--- Second PASS (columns)
-//            #pragma omp for
+            //--- Second PASS (columns), on the transposed rows
+            transpose(DTTps, DTTps_t, height, width, row_min, row_max+1);
+            transpose(ADTTps, ADTTps_t, height, width, row_min, row_max+1);
+            #pragma omp for
             for(int col = 0; col<width; ++col)
             {
-                unsigned int k = 0;
                 unsigned int indexpt1 = col*height;
-                v[indexpt1] = 0;
-                z[indexpt1] = FLT_MIN;
-                z[indexpt1 + 1] = FLT_MAX;
-                for(int row = 1; row<height; ++row)
-                {
-                    float sp1 = float(DTTps[col + row*width] + (row*row));
-                    unsigned int index2 = indexpt1 + k;
-                    unsigned int vk = v[index2];
-                    float s = (sp1 - float(DTTps[col + vk*width] + (vk*vk)))/float((row-vk) << 1);
-                    while(s <= z[index2] && k > 0)
-                    {
-                        k--;
-                        index2 = indexpt1 + k;
-                        vk = v[index2];
-                        s = (sp1 - float(DTTps[col + vk*width] + (vk*vk)))/float((row-vk) << 1);
-                    }
-                    k++;
-                    index2 = indexpt1 + k;
-                    v[index2] = row;
-                    z[index2] = s;
-                    z[index2+1] = FLT_MAX;
-                }
-                k = 0;
-                for(int row = 0; row<height; ++row)
-                {
-                    while(z[indexpt1 + k+1]<row)
-                        k++;
-                    unsigned int index2 = indexpt1 + k;
-                    unsigned int vk = v[index2];
-                    #ifdef ENABLE_DTFORM_DSTS
-                        /// Also compute the distance value
-                        float tp1 =  float(row) - float(vk);
-                        realDT[col + row*width] = sqrtf(tp1*tp1 + DTTps[col + vk*width]);
-                    #endif
-                    realADT[col + row*width] = ADTTps[col + vk*width];
-                }
+                ColumnOutput output = { this, col, indexpt1 };
+                envelope(DTTps_t + indexpt1, 1, row_min, row_max, height, indexpt1, output);
             }
+            transpose(realADT_t, realADT, width, height, 0, width);
         } ///< OPENMP
     }
 };
 
-
@@ -0,0 +1,54 @@
+#pragma once
+#include "tracker/Types.h"
+#include "tracker/DataStructure/CustomJointInfo.h"
+#include <algorithm>
+
+/// @note streaming counterpart of Jt*J and Jt*e: constraints are added one row
+///       at a time, so the jacobian never needs to be stored (see Settings::fit_streaming)
+namespace energy {
+namespace fitting {
+
+struct NormalEquations {
+	Eigen::Matrix<Scalar, num_thetas, num_thetas> JtJ;
+	Thetas JtF;
+	Scalar push_error; ///< sum of |e| over the 2D rows
+	Scalar pull_error; ///< sum of |e| over the 3D rows
+
+	void setZero() {
+		JtJ.setZero();
+		JtF.setZero();
+		push_error = 0;
+		pull_error = 0;
+	}
+
+	/// Only the upper triangle of JtJ is updated, see symmetrize()
+	void add(const SparseRow& J_row, Scalar e) {
+		for (int a = 0; a < J_row.size; ++a) {
+			int i = J_row.index[a];
+			Scalar v = J_row.value[a];
+			JtF[i] += v * e;
+			for (int b = a; b < J_row.size; ++b) {
+				int j = J_row.index[b];
+				JtJ(std::min(i, j), std::max(i, j)) += v * J_row.value[b];
+			}
+		}
+	}
+
+	/// Copies the upper triangle of JtJ to the lower one
+	void symmetrize() {
+		for (int j = 0; j < num_thetas; ++j)
+			for (int i = j + 1; i < num_thetas; ++i)
+				JtJ(i, j) = JtJ(j, i);
+	}
+
+	NormalEquations& operator+=(const NormalEquations& other) {
+		JtJ += other.JtJ;
+		JtF += other.JtF;
+		push_error += other.push_error;
+		pull_error += other.pull_error;
+		return *this;
+	}
+};
+
+} /// fitting::
+} /// energy::
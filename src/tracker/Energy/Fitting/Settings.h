@@ -17,6 +17,9 @@ namespace energy {
 			bool  fit3D_point2plane = true;
 			bool  fit3D_reweight = true;
 			bool fit3D_reweight_rigid = false;
+
+			///--- Assembly
+			bool  fit_streaming = true; ///< accumulate Jt*J and Jt*e per constraint, never store J
 		};
 	}
 }
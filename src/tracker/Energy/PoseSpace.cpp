@@ -43,6 +43,16 @@ namespace Eigen {
 		in.read((char *)vector.data(), length*sizeof(typename Vector::Scalar));
 		in.close();
 	}
+
+	/// Same as read_binary, from a section of the model bundle (see ModelBundle) if present
+	template<class Matrix>
+	void read_bundle(const ModelBundle & bundle, std::string path, std::string name, Matrix& matrix) {
+		int rows, cols;
+		const float * data = bundle.floats("pose_space/" + name, rows, cols);
+		if (data) matrix = Eigen::Map<const Eigen::Matrix<float, Eigen::Dynamic, Eigen::Dynamic>>(data, rows, cols);
+		else if (Matrix::ColsAtCompileTime == 1) read_binary_vector(path + name, matrix);
+		else read_binary(path + name, matrix);
+	}
 }
 
 namespace energy {
@@ -53,11 +63,11 @@ namespace energy {
 	float ratio_y;
 	int pixels_length_x;
 	int pixels_length_y;
-	VectorN _mu;
-	Matrix_MxN _P;	
-	Matrix_MxN _Limits;
+	Vector_System _mu;
+	Matrix_System _P;	
+	Matrix_System _Limits;
 	Worker * _worker;
-	VectorN theta_recovered;
+	Vector_System theta_recovered;
 	PoseSpaceType pose_space_type; 
 
 	void compute_pixels_to_axis_transform(cv::Mat & dataset_image) {
@@ -139,38 +149,37 @@ namespace energy {
 		tw_settings->tw_add(settings->weight_proj, "weight(proj)", "group=PoseSpace");
 		tw_settings->tw_add(settings->weight_mean, "weight(mean)", "group=PoseSpace");
 
-		Eigen::read_binary_vector<VectorN>(path_pca + "mu", mu);		
+		const ModelBundle & bundle = worker->model->bundle;
+		Eigen::read_bundle<Vector_System>(bundle, path_pca, "mu", mu);
 
 		if (settings->enable_split_pca) {
 			m = m1 + m4;
-			string path_pca_thumb = path_pca + "thumb/";
-			Eigen::read_binary<Matrix_MxN>(path_pca_thumb + "P", P1);
-			Eigen::read_binary<Matrix_MxN>(path_pca_thumb + "Sigma", Sigma1);
-			Eigen::read_binary<Matrix_MxN>(path_pca_thumb + "Limits", Limits1);
-			Matrix_MxN P1_block = P1.block(0, 0, n1, m1);  P1 = P1_block;
-			Matrix_MxN Sigma1_block = Sigma1.block(0, 0, m1, m1); Sigma1 = Sigma1_block;
+			Eigen::read_bundle<Matrix_System>(bundle, path_pca, "thumb/P", P1);
+			Eigen::read_bundle<Matrix_System>(bundle, path_pca, "thumb/Sigma", Sigma1);
+			Eigen::read_bundle<Matrix_System>(bundle, path_pca, "thumb/Limits", Limits1);
+			Matrix_System P1_block = P1.block(0, 0, n1, m1);  P1 = P1_block;
+			Matrix_System Sigma1_block = Sigma1.block(0, 0, m1, m1); Sigma1 = Sigma1_block;
 			invSigma1 = Sigma1.inverse();
 
-			string path_pca_fingers = path_pca + "fingers/";
-			Eigen::read_binary<Matrix_MxN>(path_pca_fingers + "P", P4);
-			Eigen::read_binary<Matrix_MxN>(path_pca_fingers + "Sigma", Sigma4);
-			Eigen::read_binary<Matrix_MxN>(path_pca_fingers + "Limits", Limits4);
-			Matrix_MxN P4_block = P4.block(0, 0, n4, m4);  P4 = P4_block;
-			Matrix_MxN Sigma4_block = Sigma4.block(0, 0, m4, m4); Sigma4 = Sigma4_block;
+			Eigen::read_bundle<Matrix_System>(bundle, path_pca, "fingers/P", P4);
+			Eigen::read_bundle<Matrix_System>(bundle, path_pca, "fingers/Sigma", Sigma4);
+			Eigen::read_bundle<Matrix_System>(bundle, path_pca, "fingers/Limits", Limits4);
+			Matrix_System P4_block = P4.block(0, 0, n4, m4);  P4 = P4_block;
+			Matrix_System Sigma4_block = Sigma4.block(0, 0, m4, m4); Sigma4 = Sigma4_block;
 			invSigma4 = Sigma4.inverse();
 		}
 		else if (settings->enable_joint_pca) {
-			m = settings->latent_size;
-			Eigen::read_binary<Matrix_MxN>(path_pca + "P", P);
-			Eigen::read_binary<Matrix_MxN>(path_pca + "Sigma", Sigma);
-			Eigen::read_binary<Matrix_MxN>(path_pca + "Limits", Limits);
-			Matrix_MxN P_block = P.block(0, 0, n, m);  P = P_block;
-			Matrix_MxN Sigma_block = Sigma.block(0, 0, m, m); Sigma = Sigma_block;
+			m = std::min(settings->latent_size, num_thetas_latent_max);
+			Eigen::read_bundle<Matrix_System>(bundle, path_pca, "P", P);
+			Eigen::read_bundle<Matrix_System>(bundle, path_pca, "Sigma", Sigma);
+			Eigen::read_bundle<Matrix_System>(bundle, path_pca, "Limits", Limits);
+			Matrix_System P_block = P.block(0, 0, n, m);  P = P_block;
+			Matrix_System Sigma_block = Sigma.block(0, 0, m, m); Sigma = Sigma_block;
 			invSigma = Sigma.inverse();
 		}
 	}
 
-	void PoseSpace::find_pixel_coordinates_pca(int rows, int cols, const VectorN & x, const Matrix_MxN & Limits, float & pixels_x, float & pixels_y) {
+	void PoseSpace::find_pixel_coordinates_pca(int rows, int cols, const Vector_System & x, const Matrix_System & Limits, float & pixels_x, float & pixels_y) {
 		float axis_start_x = Limits(0, 0);
 		float axis_start_y = Limits(1, 0);
 		float axis_end_x = Limits(0, 1);
@@ -184,7 +193,7 @@ namespace energy {
 	}
 
 
-	void PoseSpace::draw_latent_positions_pca(const VectorN & x, const Matrix_MxN & Limits, string path, string window_name, std::vector<VectorN> & x_history) {
+	void PoseSpace::draw_latent_positions_pca(const Vector_System & x, const Matrix_System & Limits, string path, string window_name, std::vector<Vector_System> & x_history) {
 
 		if (!settings->debug_display_latent_space) return;
 
@@ -215,27 +224,27 @@ namespace energy {
 	}
 
 
-	void PoseSpace::compute_linear_approximation(int n, int m, const VectorN & y, const VectorN & x, const Matrix_MxN & P, Matrix_MxN & LHS_E1, VectorN & rhs_E1) {
+	void PoseSpace::compute_linear_approximation(int n, int m, const Vector_System & y, const Vector_System & x, const Matrix_System & P, Matrix_System & LHS_E1, Vector_System & rhs_E1) {
 
-		Matrix_MxN LHS_e1 = Matrix_MxN::Zero(n, n + m);
-		LHS_e1.block(0, 0, n, n) = Matrix_MxN::Identity(n, n);
+		Matrix_System LHS_e1 = Matrix_System::Zero(n, n + m);
+		LHS_e1.block(0, 0, n, n) = Matrix_System::Identity(n, n);
 		LHS_e1.block(0, n, n, m) = -P;
-		VectorN rhs_e1 = y - P * x;
+		Vector_System rhs_e1 = y - P * x;
 		rhs_e1 = -rhs_e1;
 		LHS_E1 = 2 * (LHS_e1.transpose() * LHS_e1);
 		rhs_E1 = 2 * LHS_e1.transpose() * rhs_e1;
 	}
 
 
-	void PoseSpace::compute_objective(int n, int m, const VectorN & y, const VectorN & x, const Matrix_MxN & P, const Matrix_MxN & invSigma,
-		Matrix_MxN & LHS_E1_y, Matrix_MxN & LHS_E1_x, VectorN & rhs_E1_y, VectorN & rhs_E1_x,
-		Matrix_MxN & LHS_E2_y, Matrix_MxN & LHS_E2_x, VectorN & rhs_E2_y, VectorN & rhs_E2_x,
-		Matrix_MxN & LHS_E3_y, Matrix_MxN & LHS_E3_x, VectorN & rhs_E3_y, VectorN & rhs_E3_x) {
+	void PoseSpace::compute_objective(int n, int m, const Vector_System & y, const Vector_System & x, const Matrix_System & P, const Matrix_System & invSigma,
+		Matrix_System & LHS_E1_y, Matrix_System & LHS_E1_x, Vector_System & rhs_E1_y, Vector_System & rhs_E1_x,
+		Matrix_System & LHS_E2_y, Matrix_System & LHS_E2_x, Vector_System & rhs_E2_y, Vector_System & rhs_E2_x,
+		Matrix_System & LHS_E3_y, Matrix_System & LHS_E3_x, Vector_System & rhs_E3_y, Vector_System & rhs_E3_x) {
 
-		VectorN delta_y = VectorN::Zero(n);
-		VectorN delta_x = VectorN::Zero(m);
+		Vector_System delta_y = Vector_System::Zero(n);
+		Vector_System delta_x = Vector_System::Zero(m);
 
-		LHS_E1_y = 2 * Matrix_MxN::Identity(n, n);
+		LHS_E1_y = 2 * Matrix_System::Identity(n, n);
 		rhs_E1_y = 2 * y.transpose() - 2 * x.transpose() * P.transpose() - 2 * delta_x.transpose() * P.transpose();
 		LHS_E1_y = LHS_E1_y.transpose().eval();
 		rhs_E1_y = -rhs_E1_y.transpose().eval();
@@ -245,18 +254,18 @@ namespace energy {
 		LHS_E1_x = LHS_E1_x.transpose().eval();
 		rhs_E1_x = -rhs_E1_x.transpose().eval();
 
-		LHS_E2_y = 2 * Matrix_MxN::Identity(n, n);
-		rhs_E2_y = VectorN::Zero(n);
+		LHS_E2_y = 2 * Matrix_System::Identity(n, n);
+		rhs_E2_y = Vector_System::Zero(n);
 		LHS_E2_y = LHS_E2_y.transpose().eval();
 		rhs_E2_y = -rhs_E2_y.transpose().eval();
 
-		LHS_E2_x = 2 * Matrix_MxN::Identity(m, m);
-		rhs_E2_x = VectorN::Zero(m);
+		LHS_E2_x = 2 * Matrix_System::Identity(m, m);
+		rhs_E2_x = Vector_System::Zero(m);
 		LHS_E2_x = LHS_E2_x.transpose().eval();
 		rhs_E2_x = -rhs_E2_x.transpose().eval();
 
-		LHS_E3_y = Matrix_MxN::Zero(n, n);
-		rhs_E3_y = VectorN::Zero(n);
+		LHS_E3_y = Matrix_System::Zero(n, n);
+		rhs_E3_y = Vector_System::Zero(n);
 		LHS_E3_y = LHS_E3_y.transpose().eval();
 		rhs_E3_y = -rhs_E3_y.transpose().eval();
 
@@ -269,28 +278,28 @@ namespace energy {
 	}
 
 
-	void PoseSpace::assemble_joint_system(int n, int m, const Matrix_MxN & LHS_y, const Matrix_MxN & LHS_x,
-		const VectorN & rhs_y, const VectorN & rhs_x, Matrix_MxN & LHS, VectorN & rhs) {
+	void PoseSpace::assemble_joint_system(int n, int m, const Matrix_System & LHS_y, const Matrix_System & LHS_x,
+		const Vector_System & rhs_y, const Vector_System & rhs_x, Matrix_System & LHS, Vector_System & rhs) {
 
-		LHS = Matrix_MxN::Zero(n + m, n + m);
+		LHS = Matrix_System::Zero(n + m, n + m);
 		LHS.block(0, 0, n, n) = LHS_y;
 		LHS.block(n, n, m, m) = LHS_x;
-		rhs = VectorN::Zero(n + m);
+		rhs = Vector_System::Zero(n + m);
 		rhs.segment(0, n) = rhs_y;
 		rhs.segment(n, m) = rhs_x;
 
 	}
 
 
-	void PoseSpace::compose_system(int n, int m, Scalar alpha, Scalar beta, const VectorN & y, const VectorN & x,
-		const Matrix_MxN & P, const Matrix_MxN & invSigma, Matrix_MxN & LHS, VectorN & rhs) {
-		Matrix_MxN LHS_E1_y, LHS_E1_x, LHS_E2_y, LHS_E2_x, LHS_E3_y, LHS_E3_x;
-		VectorN rhs_E1_y, rhs_E1_x, rhs_E2_y, rhs_E2_x, rhs_E3_y, rhs_E3_x;
+	void PoseSpace::compose_system(int n, int m, Scalar alpha, Scalar beta, const Vector_System & y, const Vector_System & x,
+		const Matrix_System & P, const Matrix_System & invSigma, Matrix_System & LHS, Vector_System & rhs) {
+		Matrix_System LHS_E1_y, LHS_E1_x, LHS_E2_y, LHS_E2_x, LHS_E3_y, LHS_E3_x;
+		Vector_System rhs_E1_y, rhs_E1_x, rhs_E2_y, rhs_E2_x, rhs_E3_y, rhs_E3_x;
 		compute_objective(n, m, y, x, P, invSigma, LHS_E1_y, LHS_E1_x, rhs_E1_y, rhs_E1_x,
 			LHS_E2_y, LHS_E2_x, rhs_E2_y, rhs_E2_x, LHS_E3_y, LHS_E3_x, rhs_E3_y, rhs_E3_x);
 
-		Matrix_MxN LHS_E1, LHS_E2, LHS_E3;
-		VectorN rhs_E1, rhs_E2, rhs_E3;
+		Matrix_System LHS_E1, LHS_E2, LHS_E3;
+		Vector_System rhs_E1, rhs_E2, rhs_E3;
 
 		compute_linear_approximation(n, m, y, x, P, LHS_E1, rhs_E1);
 		assemble_joint_system(n, m, LHS_E2_y, LHS_E2_x, rhs_E2_y, rhs_E2_x, LHS_E2, rhs_E2);
@@ -300,10 +309,10 @@ namespace energy {
 		rhs = rhs_E1 + alpha * rhs_E2 + beta * rhs_E3;
 	}
 
-	void PoseSpace::track(LinearSystem & system, std::vector<float> _theta) {
+	void PoseSpace::track(LinearSystem & system, const std::vector<float> & _theta) {
 		if (!(settings->enable_joint_pca || settings->enable_split_pca))
 			return;
-		Eigen::Map<Thetas> theta(_theta.data());
+		Eigen::Map<const Thetas> theta(_theta.data());
 
 		if (explore_mode || random_pose) {
 			x_history.clear();
@@ -325,50 +334,52 @@ namespace energy {
 		system_pca.rhs.segment(0, q) = system.rhs;
 		system = system_pca;
 
-		VectorN y = theta.segment(p, n); y = y - mu;
-		Matrix_MxN LHS; VectorN rhs;
+		Vector_System y = theta.segment(p, n); y = y - mu;
+		Matrix_System LHS; Vector_System rhs;
 		if (settings->enable_joint_pca) {
-			VectorN x = P.transpose() * y;
-			draw_latent_positions_pca(x, Limits, path_pca, "PCA space", x_history);
+			Vector_System x = P.transpose() * y;
+			if (settings->debug_display_latent_space) draw_latent_positions_pca(x, Limits, path_pca, "PCA space", x_history); ///< avoids copying the path
 
 			compose_system(n, m, alpha, beta, y, x, P, invSigma, LHS, rhs);
 
 			system.lhs.block(p, p, n + m, n + m) += weight_fingers * LHS;
 			system.rhs.segment(p, n + m) += weight_fingers * rhs;
 		}
-		Matrix_MxN LHS1, LHS4; VectorN rhs1, rhs4;
+		Matrix_System LHS1, LHS4; Vector_System rhs1, rhs4;
 		if (settings->enable_split_pca) {
-			VectorN y1 = y.segment(0, n1);
-			VectorN y4 = y.segment(n1, n4);
-			VectorN x1 = P1.transpose() * y1;
-			VectorN x4 = P4.transpose() * y4;
-
-			draw_latent_positions_pca(x1, Limits1, path_pca + "thumb/", "Thumb PCA space", x1_history);
-			draw_latent_positions_pca(x4, Limits4, path_pca + "fingers/", "Fingers PCA space", x4_history);
+			Vector_System y1 = y.segment(0, n1);
+			Vector_System y4 = y.segment(n1, n4);
+			Vector_System x1 = P1.transpose() * y1;
+			Vector_System x4 = P4.transpose() * y4;
+
+			if (settings->debug_display_latent_space) { ///< avoids building the paths
+				draw_latent_positions_pca(x1, Limits1, path_pca + "thumb/", "Thumb PCA space", x1_history);
+				draw_latent_positions_pca(x4, Limits4, path_pca + "fingers/", "Fingers PCA space", x4_history);
+			}
 
-			Matrix_MxN LHS_e1, LHS_E1, LHS_E2, LHS_E3;
-			VectorN rhs_e1, rhs_E1, rhs_E2, rhs_E3;
+			Matrix_System LHS_e1, LHS_E1, LHS_E2, LHS_E3;
+			Vector_System rhs_e1, rhs_E1, rhs_E2, rhs_E3;
 			{
-				LHS_e1 = Matrix_MxN::Zero(n, n + m);
-				LHS_e1.block(0, 0, n, n) = Matrix_MxN::Identity(n, n);
-				LHS_e1.block(n1, n1, n4, n4) = Matrix_MxN::Zero(n4, n4);
+				LHS_e1 = Matrix_System::Zero(n, n + m);
+				LHS_e1.block(0, 0, n, n) = Matrix_System::Identity(n, n);
+				LHS_e1.block(n1, n1, n4, n4) = Matrix_System::Zero(n4, n4);
 				LHS_e1.block(0, n, n1, m1) = -P1;
 
-				rhs_e1 = VectorN::Zero(n);
+				rhs_e1 = Vector_System::Zero(n);
 				rhs_e1.segment(0, n1) = -y1 + P1 * x1;
 
 				LHS_E1 = 2 * (LHS_e1.transpose() * LHS_e1);
 				rhs_E1 = 2 * LHS_e1.transpose() * rhs_e1;
 
-				LHS_E2 = Matrix_MxN::Zero(n + m, n + m);
-				LHS_E2.block(0, 0, n1, n1) = 2 * Matrix_MxN::Identity(n1, n1);
-				LHS_E2.block(n, n, m1, m1) = 2 * Matrix_MxN::Identity(m1, m1);
-				rhs_E2 = VectorN::Zero(n + m);
+				LHS_E2 = Matrix_System::Zero(n + m, n + m);
+				LHS_E2.block(0, 0, n1, n1) = 2 * Matrix_System::Identity(n1, n1);
+				LHS_E2.block(n, n, m1, m1) = 2 * Matrix_System::Identity(m1, m1);
+				rhs_E2 = Vector_System::Zero(n + m);
 
-				LHS_E3 = Matrix_MxN::Zero(n + m, n + m);
+				LHS_E3 = Matrix_System::Zero(n + m, n + m);
 				LHS_E3.block(n, n, m1, m1) = 2 * invSigma1;
 
-				rhs_E3 = VectorN::Zero(n + m);
+				rhs_E3 = Vector_System::Zero(n + m);
 				rhs_E3.segment(n, m1) = -2 * x1.transpose() * invSigma1;
 
 				LHS1 = LHS_E1 + alpha * LHS_E2 + beta * LHS_E3;
@@ -380,26 +391,26 @@ namespace energy {
 
 			{
 
-				LHS_e1 = Matrix_MxN::Zero(n, n + m);
-				LHS_e1.block(0, 0, n, n) = Matrix_MxN::Identity(n, n);
-				LHS_e1.block(0, 0, n1, n1) = Matrix_MxN::Zero(n1, n1);
+				LHS_e1 = Matrix_System::Zero(n, n + m);
+				LHS_e1.block(0, 0, n, n) = Matrix_System::Identity(n, n);
+				LHS_e1.block(0, 0, n1, n1) = Matrix_System::Zero(n1, n1);
 				LHS_e1.block(n1, n + m1, n4, m4) = -P4;
 
-				rhs_e1 = VectorN::Zero(n);
+				rhs_e1 = Vector_System::Zero(n);
 				rhs_e1.segment(n1, n4) = -y4 + P4 * x4;
 
 				LHS_E1 = 2 * (LHS_e1.transpose() * LHS_e1);
 				rhs_E1 = 2 * LHS_e1.transpose() * rhs_e1;
 
-				LHS_E2 = Matrix_MxN::Zero(n + m, n + m);
-				LHS_E2.block(n1, n1, n4, n4) = 2 * Matrix_MxN::Identity(n4, n4);
-				LHS_E2.block(n + m1, n1 + m1, m4, m4) = 2 * Matrix_MxN::Identity(m4, m4);
-				rhs_E2 = VectorN::Zero(n + m);
+				LHS_E2 = Matrix_System::Zero(n + m, n + m);
+				LHS_E2.block(n1, n1, n4, n4) = 2 * Matrix_System::Identity(n4, n4);
+				LHS_E2.block(n + m1, n1 + m1, m4, m4) = 2 * Matrix_System::Identity(m4, m4);
+				rhs_E2 = Vector_System::Zero(n + m);
 
-				LHS_E3 = Matrix_MxN::Zero(n + m, n + m);
+				LHS_E3 = Matrix_System::Zero(n + m, n + m);
 				LHS_E3.block(n + m1, n + m1, m4, m4) = 2 * invSigma4;
 
-				rhs_E3 = VectorN::Zero(n + m);
+				rhs_E3 = Vector_System::Zero(n + m);
 				rhs_E3.segment(n + m1, m4) = -2 * x4.transpose() * invSigma4;
 
 				LHS4 = LHS_E1 + alpha * LHS_E2 + beta * LHS_E3;
@@ -26,14 +26,14 @@ public:
 	
 	void init(Worker * worker);
 	void explore_pose_space(int pose_space_type);
-    void track(LinearSystem &system, std::vector<float> theta);
+    void track(LinearSystem &system, const std::vector<float> &theta);
 private:
-    void find_pixel_coordinates_pca(int rows, int cols, const VectorN &x, const Matrix_MxN &Limits, float &pixels_x, float &pixels_y);
-    void draw_latent_positions_pca(const VectorN &x, const Matrix_MxN &Limits, string path, string window_name, std::vector<VectorN> &x_history);
-    void compute_linear_approximation(int n, int m, const VectorN &y, const VectorN &x, const Matrix_MxN &P, Matrix_MxN &LHS_E1, VectorN &rhs_E1);
-    void compute_objective(int n, int m, const VectorN &y, const VectorN &x, const Matrix_MxN &P, const Matrix_MxN &invSigma, Matrix_MxN &LHS_E1_y, Matrix_MxN &LHS_E1_x, VectorN &rhs_E1_y, VectorN &rhs_E1_x, Matrix_MxN &LHS_E2_y, Matrix_MxN &LHS_E2_x, VectorN &rhs_E2_y, VectorN &rhs_E2_x, Matrix_MxN &LHS_E3_y, Matrix_MxN &LHS_E3_x, VectorN &rhs_E3_y, VectorN &rhs_E3_x);
-    void assemble_joint_system(int n, int m, const Matrix_MxN &LHS_y, const Matrix_MxN &LHS_x, const VectorN &rhs_y, const VectorN &rhs_x, Matrix_MxN &LHS, VectorN &rhs);
-    void compose_system(int n, int m, Scalar alpha, Scalar beta, const VectorN &y, const VectorN &x, const Matrix_MxN &P, const Matrix_MxN &invSigma, Matrix_MxN &LHS, VectorN &rhs);
+    void find_pixel_coordinates_pca(int rows, int cols, const Vector_System &x, const Matrix_System &Limits, float &pixels_x, float &pixels_y);
+    void draw_latent_positions_pca(const Vector_System &x, const Matrix_System &Limits, string path, string window_name, std::vector<Vector_System> &x_history);
+    void compute_linear_approximation(int n, int m, const Vector_System &y, const Vector_System &x, const Matrix_System &P, Matrix_System &LHS_E1, Vector_System &rhs_E1);
+    void compute_objective(int n, int m, const Vector_System &y, const Vector_System &x, const Matrix_System &P, const Matrix_System &invSigma, Matrix_System &LHS_E1_y, Matrix_System &LHS_E1_x, Vector_System &rhs_E1_y, Vector_System &rhs_E1_x, Matrix_System &LHS_E2_y, Matrix_System &LHS_E2_x, Vector_System &rhs_E2_y, Vector_System &rhs_E2_x, Matrix_System &LHS_E3_y, Matrix_System &LHS_E3_x, Vector_System &rhs_E3_y, Vector_System &rhs_E3_x);
+    void assemble_joint_system(int n, int m, const Matrix_System &LHS_y, const Matrix_System &LHS_x, const Vector_System &rhs_y, const Vector_System &rhs_x, Matrix_System &LHS, Vector_System &rhs);
+    void compose_system(int n, int m, Scalar alpha, Scalar beta, const Vector_System &y, const Vector_System &x, const Matrix_System &P, const Matrix_System &invSigma, Matrix_System &LHS, Vector_System &rhs);
 public:
     int m = 2;  ///< latent space dimension
     int m1 = 2; ///< latent space dimension (split/1)
@@ -49,29 +49,29 @@ public:
     string subfolder_pca = "PoseSpace_PCA/";
     string path_pca;
 
-    VectorN mu;
+    Vector_System mu;
 
-    Matrix_MxN P;
-    Matrix_MxN Sigma;
-    Matrix_MxN invSigma;
-    Matrix_MxN Limits;
+    Matrix_System P;
+    Matrix_System Sigma;
+    Matrix_System invSigma;
+    Matrix_System Limits;
 
-    Matrix_MxN P1;
-    Matrix_MxN Sigma1;
-    Matrix_MxN invSigma1;
-    Matrix_MxN Limits1;
+    Matrix_System P1;
+    Matrix_System Sigma1;
+    Matrix_System invSigma1;
+    Matrix_System Limits1;
 
-    Matrix_MxN P4;
-    Matrix_MxN Sigma4;
-    Matrix_MxN invSigma4;
-    Matrix_MxN Limits4;
+    Matrix_System P4;
+    Matrix_System Sigma4;
+    Matrix_System invSigma4;
+    Matrix_System Limits4;
 
-	VectorN theta_recovered;
+	Vector_System theta_recovered;
 
 /// @{ used to visualize path in latent space
-    std::vector<VectorN> x_history;
-    std::vector<VectorN> x1_history;
-    std::vector<VectorN> x4_history;
+    std::vector<Vector_System> x_history;
+    std::vector<Vector_System> x1_history;
+    std::vector<Vector_System> x4_history;
 /// @}
 };
 
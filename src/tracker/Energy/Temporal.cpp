@@ -2,32 +2,42 @@
 #include "tracker/Data/DataFrame.h"
 #include "tracker/TwSettings.h"
 #include "tracker/HModel/Model.h"
+#include <algorithm>
 
-/// Queue for temporal coherence
+/// Queue for temporal coherence, the solutions of the last 3 frames in preallocated slots (slot = id mod 3)
 class SolutionQueue {
 public:
 	typedef std::vector<Scalar> Solution;
-	typedef std::map<int, Solution> Solutions;
-	Solutions solutions;
+	static const int num_slots = 3;
+	int ids[num_slots]; ///< frame of the solution in each slot, -1 if none
+	Solution solutions[num_slots];
+
+	SolutionQueue() {
+		for (int k = 0; k < num_slots; k++) {
+			ids[k] = -1;
+			solutions[k].resize(num_thetas);
+		}
+	}
+	static int slot(int id) { return ((id % num_slots) + num_slots) % num_slots; }
 
-	bool valid(int id) {
-		return id >= 2
-			&& solutions.find(id - 1) != solutions.end()
-			&& solutions.find(id - 2) != solutions.end();
+	/// @return NULL if the solution of this frame is not in the queue
+	const Solution * find(int id) const {
+		int k = slot(id);
+		return (id >= 0 && ids[k] == id) ? &solutions[k] : NULL;
+	}
+	bool valid(int id) const {
+		return id >= 2 && find(id - 1) && find(id - 2);
 	}
 	void set(int id, const Solution &s) {
-		solutions[id] = s;
+		int k = slot(id);
+		ids[k] = id;
+		std::copy(s.begin(), s.begin() + std::min(s.size(), solutions[k].size()), solutions[k].begin()); ///< no reallocation
 	}
 	void update(int id, const Solution &s) {
 		set(id, s);
-		for (auto it = solutions.begin(); it != solutions.end();) {
-			int d = id - it->first;
-			if (d > 2 || d < 0) {
-				it = solutions.erase(it);
-			}
-			else {
-				++it;
-			}
+		for (int k = 0; k < num_slots; k++) {
+			int d = id - ids[k];
+			if (d > 2 || d < 0) ids[k] = -1;
 		}
 	}
 };
@@ -37,6 +47,7 @@ namespace energy {
 	void Temporal::init(Model * model) {
 		this->model = model;
 		this->solution_queue = new SolutionQueue();
+		this->pose_geometry = new PoseGeometry();
 		tw_settings->tw_add(settings->temporal_coherence1_enable, "1st Order", "group=Temporal");
 		tw_settings->tw_add(settings->temporal_coherence2_enable, "2nd Order", "group=Temporal");
 		tw_settings->tw_add(settings->temporal_coherence1_weight, "weight(1st)", "group=Temporal");
@@ -45,26 +56,22 @@ namespace energy {
 
 	Temporal::~Temporal() {
 		if (solution_queue) delete solution_queue;
+		if (pose_geometry) delete pose_geometry;
 	}
 
 	void Temporal::update(int frame_id, const std::vector<Scalar> & theta) {
 		solution_queue->update(frame_id, theta);
 	}
 
-	void extract_positions(Model * model, const vector<int> & joint_ids, const vector<int> & center_ids,
-		const vector<Scalar> & theta_previous, const vector<Scalar> & theta_current, vector<Vector3> & positions) {
-		if (theta_previous.empty()) return;			
-		positions.resize(joint_ids.size());
-
-		model->move(theta_previous);
-		model->update_centers();
-		//cout << "HMODEL" << endl;
-		for (size_t i = 0; i < joint_ids.size(); ++i) {
-			glm::vec3 c = model->centers[center_ids[i]];
-			positions[i] = Vector3(c[0], c[1], c[2]);			
+	void extract_positions(const Model * model, const vector<int> & center_ids, const vector<Scalar> & theta, PoseGeometry & geometry, vector<Vector3> & positions) {
+		if (theta.empty()) return;
+		positions.resize(center_ids.size());
+
+		model->evaluate(theta, geometry, false);
+		for (size_t i = 0; i < center_ids.size(); ++i) {
+			glm::vec3 c = geometry.centers[center_ids[i]];
+			positions[i] = Vector3(c[0], c[1], c[2]);
 		}
-		model->move(theta_current);
-		model->update_centers();
 	}
 
 	void Temporal::temporal_coherence_init() {
@@ -110,9 +117,9 @@ namespace energy {
 		}*/
 	}
 
-	void Temporal::track(LinearSystem& system, int fid, bool first_order) {
-		if (first_order) if (!settings->temporal_coherence1_enable) return;
-		else if (!settings->temporal_coherence2_enable) return;
+	void Temporal::update_positions(DataFrame & frame) {
+		if (!settings->temporal_coherence1_enable && !settings->temporal_coherence2_enable) return;
+		int fid = frame.id;
 
 		// TIMED_BLOCK(timer,"Worker::temporal_coherence_track(extract positions)")
 		{
@@ -122,14 +129,20 @@ namespace energy {
 
 			if (solution_queue->valid(fid)) {
 				if (fid != fid_curr) {
-					vector<float> theta_current = model->get_theta();
-					extract_positions(model, joint_ids, center_ids, solution_queue->solutions[fid - 1], theta_current, pos_prev1);
-					extract_positions(model, joint_ids, center_ids, solution_queue->solutions[fid - 2], theta_current, pos_prev2);
+					extract_positions(model, center_ids, *solution_queue->find(fid - 1), *pose_geometry, pos_prev1);
+					extract_positions(model, center_ids, *solution_queue->find(fid - 2), *pose_geometry, pos_prev2);
 					fid_curr = fid;
 				}
 			}
-			else return;
 		}
+	}
+
+	/// @note only reads the model, positions of the previous frames come from update_positions
+	void Temporal::track(LinearSystem& system, int fid, bool first_order) {
+		if (first_order) if (!settings->temporal_coherence1_enable) return;
+		else if (!settings->temporal_coherence2_enable) return;
+
+		if (!solution_queue->valid(fid) || fid != fid_curr) return;
 
 		// TIMED_BLOCK(timer,"Worker::temporal_coherence_track(compute jacobian)")
 		{
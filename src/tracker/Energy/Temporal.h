@@ -10,6 +10,7 @@ class Temporal : public Energy{
 	Model * model = NULL;	
 
     SolutionQueue* solution_queue = NULL;
+    PoseGeometry* pose_geometry = NULL; ///< workspace to evaluate the previous solutions
     std::vector<int> joint_ids;
 	std::vector<int> center_ids;
 	std::vector<int> phalange_ids;
@@ -31,6 +32,7 @@ public:
     ~Temporal();
     void track(LinearSystem& system, DataFrame& frame);
     void update(int frame_id, const std::vector<Scalar>& Solution);
+    void update_positions(DataFrame& frame); ///< call before track, only reads the model
 private:
 	void track(LinearSystem& system, int fid, bool first_order);
 	void temporal_coherence_init();
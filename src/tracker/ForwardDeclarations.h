@@ -24,6 +24,7 @@ class TrivialDetector;
 class Skeleton; ///< Legacy
 class ICP; ///< Legacy
 class Model;
+struct PoseGeometry;
 
 class Sensor;
 class SensorOpenNI;
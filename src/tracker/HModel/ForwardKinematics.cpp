@@ -0,0 +1,95 @@
+#include "ForwardKinematics.h"
+#include "Model.h"
+#include <Eigen/Geometry>
+
+ForwardKinematics::ForwardKinematics(Model * _model) : model(_model) {}
+
+namespace {
+int canonical_axis(const Vec3f & axis) {
+	for (int k = 0; k < 3; k++)
+		if (axis == Vec3f::Unit(k)) return k;
+	return -1;
+}
+}
+
+void ForwardKinematics::setup() {
+	const std::vector<Phalange> & phalanges = model->phalanges;
+	const std::vector<Dof> & dofs = model->dofs;
+	const int num_nodes = num_phalanges + 1;
+
+	///--- Topological order, following parent_id (children_ids is not complete, e.g. for the wrist)
+	order.clear();
+	std::vector<bool> visited(num_nodes, false);
+	while (order.size() < (size_t)num_nodes) {
+		size_t num_visited = order.size();
+		for (int i = 0; i < num_nodes; i++) {
+			int parent_id = phalanges[i].parent_id;
+			if (visited[i] || (parent_id >= 0 && !visited[parent_id])) continue;
+			visited[i] = true;
+			order.push_back(i);
+		}
+		if (order.size() == num_visited) {
+			std::cout << "cycle in the phalanges hierarchy" << std::endl;
+			break;
+		}
+	}
+
+	///--- Joints are applied in passes: pose, then flexion (X), abduction (Z), twist (Y)
+	joints.clear();
+	for (size_t i = 0; i < dofs.size(); i++) {
+		if (dofs[i].phalange_id == -1) continue;
+		if (dofs[i].phalange_id < num_phalanges && dofs[i].type == ROTATION_AXIS) continue;
+		Joint joint = { (int)i, (int)dofs[i].phalange_id, canonical_axis(dofs[i].axis) };
+		joints.push_back(joint);
+	}
+	const int passes[3] = { 0, 2, 1 };
+	for (int pass = 0; pass < 3; pass++) {
+		for (size_t i = 0; i < dofs.size(); i++) {
+			if (!(dofs[i].phalange_id < num_phalanges && dofs[i].type == ROTATION_AXIS)) continue;
+			int axis = canonical_axis(dofs[i].axis);
+			if (axis == -1 && pass == 0) std::cout << "wrong axis" << std::endl;
+			if (axis != passes[pass]) continue;
+			Joint joint = { (int)i, (int)dofs[i].phalange_id, axis };
+			joints.push_back(joint);
+		}
+	}
+}
+
+void ForwardKinematics::compute(const float * theta, Mat4f * locals, Mat4f * globals) const {
+	const std::vector<Phalange> & phalanges = model->phalanges;
+	const std::vector<Dof> & dofs = model->dofs;
+
+	for (size_t i = 0; i < order.size(); i++)
+		locals[order[i]] = phalanges[order[i]].init_local;
+
+	for (size_t i = 0; i < joints.size(); i++) {
+		const Joint & joint = joints[i];
+		const Dof & dof = dofs[joint.dof];
+		Mat4f & local = locals[joint.phalange];
+		float angle = theta[joint.dof];
+		if (dof.type == TRANSLATION_AXIS) {
+			local.block<3, 1>(0, 3) += dof.axis * angle;
+		}
+		else if (joint.axis >= 0) {
+			///--- Right multiplication by a rotation about a canonical axis only mixes two columns
+			int a = (joint.axis + 1) % 3;
+			int b = (joint.axis + 2) % 3;
+			float c = std::cos(angle);
+			float s = std::sin(angle);
+			Vec4f u = local.col(a);
+			Vec4f v = local.col(b);
+			local.col(a) = c * u + s * v;
+			local.col(b) = c * v - s * u;
+		}
+		else {
+			local = local * Transform3f(Eigen::AngleAxisf(angle, dof.axis)).matrix();
+		}
+	}
+
+	for (size_t i = 0; i < order.size(); i++) {
+		int id = order[i];
+		int parent_id = phalanges[id].parent_id;
+		if (parent_id >= 0) globals[id].noalias() = globals[parent_id] * locals[id];
+		else globals[id] = locals[id];
+	}
+}
@@ -0,0 +1,31 @@
+#pragma once
+#include <vector>
+#include "util/MathUtils.h"
+
+class Model;
+
+/// Flat forward kinematics: the phalanges are visited once, parents first,
+/// instead of re-propagating the whole subtree after every joint transformation.
+class ForwardKinematics {
+
+	struct Joint {
+		int dof;
+		int phalange;
+		int axis; ///< 0, 1, 2 for the canonical rotation axes, -1 otherwise
+	};
+
+	std::vector<int> order; ///< phalange ids, parents before children
+	std::vector<Joint> joints; ///< in the order they are applied to the local transformations
+
+public:
+	Model * const model;
+
+	ForwardKinematics(Model * _model);
+
+	/// To be called once the phalanges and the dofs are set up, see ModelSemantics
+	void setup();
+
+	/// @param theta num_thetas pose parameters
+	/// @param locals, globals transformations indexed by phalange id, at least num_phalanges + 1 entries
+	void compute(const float * theta, Mat4f * locals, Mat4f * globals) const;
+};
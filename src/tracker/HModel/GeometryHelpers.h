@@ -159,7 +159,8 @@ bool intersect_segment_segment(const glm::dvec2 & a, const glm::dvec2 & b, const
 	if (xi < std::min(x3, x4) || xi > std::max(x3, x4)) return false;
 }
 
-std::vector<std::pair<glm::dvec2, glm::dvec2>> intersect_segment_segment_same_circle(const glm::dvec2 & c, double r, const glm::dvec2 & s1, const glm::dvec2 & e1, const glm::dvec2 & s2, const glm::dvec2 & e2) {
+/// @return number of intersections, at most 4 (each arc is split in at most 2 at angle 0)
+int intersect_segment_segment_same_circle(const glm::dvec2 & c, double r, const glm::dvec2 & s1, const glm::dvec2 & e1, const glm::dvec2 & s2, const glm::dvec2 & e2, std::pair<glm::dvec2, glm::dvec2> intersections[4]) {
 	glm::dvec2 v1 = s1 - c;
 	glm::dvec2 u1 = e1 - c;
 	double alpha1 = atan2(v1[1], v1[0]);
@@ -174,34 +175,36 @@ std::vector<std::pair<glm::dvec2, glm::dvec2>> intersect_segment_segment_same_ci
 	if (alpha2 < 0) alpha2 = alpha2 + 2 * M_PI; 
 	if (beta2 < 0) beta2 = beta2 + 2 * M_PI; 
 
-	std::vector<std::pair<double, double>> arcs1;
+	std::pair<double, double> arcs1[2];
+	size_t num_arcs1 = 0;
 	if (alpha1 < beta1)
-		arcs1.push_back(std::pair<double, double>(alpha1, beta1));
+		arcs1[num_arcs1++] = std::pair<double, double>(alpha1, beta1);
 	else {
-		arcs1.push_back(std::pair<double, double>(0, beta1));
-		arcs1.push_back(std::pair<double, double>(alpha1, 2 * M_PI));
+		arcs1[num_arcs1++] = std::pair<double, double>(0, beta1);
+		arcs1[num_arcs1++] = std::pair<double, double>(alpha1, 2 * M_PI);
 	}
-	std::vector<std::pair<double, double>> arcs2;
+	std::pair<double, double> arcs2[2];
+	size_t num_arcs2 = 0;
 	if (alpha2 < beta2)
-		arcs2.push_back(std::pair<double, double>(alpha2, beta2));
+		arcs2[num_arcs2++] = std::pair<double, double>(alpha2, beta2);
 	else {
-		arcs2.push_back(std::pair<double, double>(0, beta2));
-		arcs2.push_back(std::pair<double, double>(alpha2, 2 * M_PI));
+		arcs2[num_arcs2++] = std::pair<double, double>(0, beta2);
+		arcs2[num_arcs2++] = std::pair<double, double>(alpha2, 2 * M_PI);
 	}
-	std::vector<std::pair<glm::dvec2, glm::dvec2>> intersections;
+	int num_intersections = 0;
 	double gamma, delta; glm::dvec2 a; glm::dvec2 b;
-	for (size_t i = 0; i < arcs1.size(); i++) {
-		for (size_t j = 0; j < arcs2.size(); j++) {
+	for (size_t i = 0; i < num_arcs1; i++) {
+		for (size_t j = 0; j < num_arcs2; j++) {
 			if (std::max(arcs1[i].first, arcs2[j].first) < std::min(arcs1[i].second, arcs2[j].second)) {
 				gamma = std::max(arcs1[i].first, arcs2[j].first);
 				delta = std::min(arcs1[i].second, arcs2[j].second);
 				a = c + r * glm::dvec2(cos(gamma), sin(gamma));
 				b = c + r * glm::dvec2(cos(delta), sin(delta));
-				intersections.push_back(std::pair<glm::dvec2, glm::dvec2>(a, b));
+				intersections[num_intersections++] = std::pair<glm::dvec2, glm::dvec2>(a, b);
 			}
 		}
 	}	
-	return intersections;
+	return num_intersections;
 }
 
 glm::dvec3 project_point_on_plane(const glm::dvec3 & p, const glm::dvec3 & p0, const glm::dvec3 & n) {
@@ -9,7 +9,21 @@
 #include "tracker/OpenGL/DebugRenderer/DebugRenderer.h"
 #include "tracker/Data/Camera.h"
 
-Model::Model() :outline_finder(this), serializer(this), semantics(this) {
+namespace {
+const std::string model_folder_path = "models/anastasia/";
+
+/// Min and max of each dof, the "dof_limits" section of the bundle
+std::vector<float> get_dof_limits(const std::vector<Dof> & dofs) {
+	std::vector<float> dof_limits(2 * dofs.size());
+	for (size_t i = 0; i < dofs.size(); i++) {
+		dof_limits[2 * i] = dofs[i].min;
+		dof_limits[2 * i + 1] = dofs[i].max;
+	}
+	return dof_limits;
+}
+}
+
+Model::Model() :outline_finder(this), serializer(this), semantics(this), forward_kinematics(this) {
 	centers = std::vector<glm::vec3>();
 	radii = std::vector<float>();
 	blocks = std::vector<glm::ivec3>();
@@ -30,15 +44,13 @@ Model::Model() :outline_finder(this), serializer(this), semantics(this) {
 	rendered_pixels = new int[upper_bound_num_rendered_outline_points];
 	rendered_points = new float[3 * upper_bound_num_rendered_outline_points];
 	rendered_block_ids = new int[upper_bound_num_rendered_outline_points];
+	outline_samples.resize(2 * upper_bound_num_rendered_outline_points, Eigen::NoChange); ///< grown (doubled) only for larger outlines
+	outline_samples_block.reserve(outline_samples.rows());
+	outline_num_samples.reserve(max_num_outlines);
 }
 
 Model::~Model() {
-	if (host_pointer_centers) delete[] host_pointer_centers;
-	if (host_pointer_radii) delete[] host_pointer_radii;
-	if (host_pointer_blocks) delete[] host_pointer_blocks;
-	if (host_pointer_tangent_points) delete[] host_pointer_tangent_points;
 	if (host_pointer_outline) delete[] host_pointer_outline;
-	if (host_pointer_blockid_to_jointid_map) delete[] host_pointer_blockid_to_jointid_map;
 	delete[] rendered_pixels;
 	delete[] rendered_points;
 	delete[] rendered_block_ids;
@@ -50,11 +62,27 @@ void Model::init(int user_name, std::string data_path) {
 	this->data_path = data_path;	
 
 	if (model_type == HMODEL_OLD || model_type == HMODEL) {
-		load_model_from_file();
+		///--- The text model when the bundle is missing, incomplete or older than it (see convert_text_model)
+		std::string model_path = data_path + model_folder_path;
+		std::string bundle_path = model_path + "model.hmb";
+		bool loaded = is_bundle_up_to_date(model_path, data_path + "pose_space/", bundle_path) && load_model_from_bundle(bundle_path);
+		if (!loaded) {
+			cout << "no up to date model bundle " << bundle_path << ", reading the text model" << endl;
+			load_model_from_file();
+		}
 		semantics.setup_topology();
 		semantics.setup_outline();
 		semantics.setup_dofs();
+		int rows, cols;
+		const float * dof_limits = bundle.floats("dof_limits", rows, cols);
+		if (dof_limits && rows == 2 && cols == num_thetas) {
+			for (size_t i = 0; i < num_thetas; i++) {
+				dofs[i].min = dof_limits[2 * i];
+				dofs[i].max = dof_limits[2 * i + 1];
+			}
+		}
 		semantics.setup_phalanges();
+		forward_kinematics.setup();
 		move(std::vector<float>(num_thetas, 0));
 		initialize_offsets();
 	}
@@ -123,6 +151,7 @@ void Model::reindex() {
 			}
 		}
 	}
+	local_tangent_points.clear(); ///< blocks or radii changed
 }
 
 void Model::compute_outline() {
@@ -131,8 +160,8 @@ void Model::compute_outline() {
 	//outline_finder.compute_projections_outline(centers, radii, data_points, camera_ray);
 }
 
-void Model::compute_tangent_point(const glm::vec3 & camera_ray, glm::vec3 & c1, const glm::vec3 & c2, const glm::vec3 & c3, float r1, float r2, float r3,
-	glm::vec3 & v1, glm::vec3 & v2, glm::vec3 & v3, glm::vec3 & u1, glm::vec3 & u2, glm::vec3 & u3, glm::vec3 & n, glm::vec3 & m) {
+void Model::compute_tangent_point(const glm::vec3 & camera_ray, const glm::vec3 & c1, const glm::vec3 & c2, const glm::vec3 & c3, float r1, float r2, float r3,
+	glm::vec3 & v1, glm::vec3 & v2, glm::vec3 & v3, glm::vec3 & u1, glm::vec3 & u2, glm::vec3 & u3, glm::vec3 & n, glm::vec3 & m) const {
 
 	/*std::cout << "c1 = (" << c1[0] << ", " << c1[1] << ", " << c1[2] << ")" << std::endl;
 	std::cout << "c2 = (" << c2[0] << ", " << c2[1] << ", " << c2[2] << ")" << std::endl;
@@ -204,21 +233,90 @@ void Model::compute_tangent_point(const glm::vec3 & camera_ray, glm::vec3 & c1,
 }
 
 void Model::compute_tangent_points() {
-	//cout << "centers.size() = " << centers.size() << endl;
-	//cout << "radii.size() = " << radii.size() << endl;
-	//cout << "blocks.size() = " << blocks.size() << endl;
-	tangent_points = std::vector<Tangent>(blocks.size(), Tangent());
+	compute_tangent_points(centers, tangent_points);
+}
+
+void Model::compute_tangent_points(const std::vector<glm::vec3> & centers, std::vector<Tangent> & tangent_points) const {
+	tangent_points.assign(blocks.size(), Tangent());
 	for (size_t i = 0; i < blocks.size(); i++) {
 		if (blocks[i][2] > centers.size()) continue;
-		//cout << "c1 = " << centers[blocks[i][0]][0] << endl;
-		//cout << "c2 = " << centers[blocks[i][1]][0] << endl;
-		//cout << "c3 = " << centers[blocks[i][2]][0] << endl;
 		compute_tangent_point(camera_ray, centers[blocks[i][0]], centers[blocks[i][1]], centers[blocks[i][2]],
 			radii[blocks[i][0]], radii[blocks[i][1]], radii[blocks[i][2]],
 			tangent_points[i].v1, tangent_points[i].v2, tangent_points[i].v3,
 			tangent_points[i].u1, tangent_points[i].u2, tangent_points[i].u3,
 			tangent_points[i].n, tangent_points[i].m);
-		//std::cout << "in model: (" << tangent_points[i].v1[0] << ", " << tangent_points[i].v1[1] << ", " << tangent_points[i].v1[2] << " ); " << std::endl;
+	}
+}
+
+void Model::update_tangent_points() {
+	if (local_tangent_points.size() != blocks.size()) {
+		centerid_to_phalangeid.assign(centers.size(), -1);
+		for (size_t i = 0; i < num_phalanges; i++) {
+			centerid_to_phalangeid[phalanges[i].center_id] = i;
+			for (size_t j = 0; j < phalanges[i].attachments.size(); j++)
+				centerid_to_phalangeid[phalanges[i].attachments[j]] = i;
+		}
+		local_tangent_points.assign(blocks.size(), Tangent());
+		local_block_centers.assign(3 * blocks.size(), glm::vec3(0));
+		local_tangent_points_valid.assign(blocks.size(), false);
+	}
+
+	glm::mat3 rotations[num_phalanges];
+	glm::mat3 inverse_rotations[num_phalanges];
+	glm::vec3 translations[num_phalanges];
+	for (size_t i = 0; i < num_phalanges; i++) {
+		const Mat4f & global = phalanges[i].global;
+		for (int c = 0; c < 3; c++)
+			for (int r = 0; r < 3; r++) rotations[i][c][r] = global(r, c);
+		inverse_rotations[i] = glm::inverse(rotations[i]);
+		translations[i] = glm::vec3(global(0, 3), global(1, 3), global(2, 3));
+	}
+
+	tangent_points.resize(blocks.size());
+	for (size_t i = 0; i < blocks.size(); i++) {
+		Tangent & t = tangent_points[i];
+		if (blocks[i][2] > centers.size()) { t = Tangent(); continue; }
+		const glm::vec3 & c1 = centers[blocks[i][0]];
+		const glm::vec3 & c2 = centers[blocks[i][1]];
+		const glm::vec3 & c3 = centers[blocks[i][2]];
+		float r1 = radii[blocks[i][0]], r2 = radii[blocks[i][1]], r3 = radii[blocks[i][2]];
+
+		int p = centerid_to_phalangeid[blocks[i][0]];
+		if (p < 0) {
+			compute_tangent_point(camera_ray, c1, c2, c3, r1, r2, r3, t.v1, t.v2, t.v3, t.u1, t.u2, t.u3, t.n, t.m);
+			continue;
+		}
+		const glm::mat3 & R = rotations[p];
+		const glm::mat3 & R_inv = inverse_rotations[p];
+		const glm::vec3 & o = translations[p];
+
+		///--- Rigid motion of the whole block: transform the cached tangent points, otherwise recompute them
+		glm::vec3 * local_centers = &local_block_centers[3 * i];
+		glm::vec3 l1 = R_inv * (c1 - o), l2 = R_inv * (c2 - o), l3 = R_inv * (c3 - o);
+		glm::vec3 d1 = l1 - local_centers[0], d2 = l2 - local_centers[1], d3 = l3 - local_centers[2];
+		float displacement2 = glm::max(dot(d1, d1), glm::max(dot(d2, d2), dot(d3, d3)));
+		if (local_tangent_points_valid[i] && displacement2 < tangent_points_tolerance * tangent_points_tolerance) {
+			const Tangent & l = local_tangent_points[i];
+			t.v1 = R * l.v1 + o; t.v2 = R * l.v2 + o; t.v3 = R * l.v3 + o; t.n = R * l.n;
+			t.u1 = R * l.u1 + o; t.u2 = R * l.u2 + o; t.u3 = R * l.u3 + o; t.m = R * l.m;
+		}
+		else {
+			///--- A null camera ray keeps the two sides in the order of the construction, which is invariant to rigid motions
+			compute_tangent_point(glm::vec3(0), c1, c2, c3, r1, r2, r3, t.v1, t.v2, t.v3, t.u1, t.u2, t.u3, t.n, t.m);
+			Tangent & l = local_tangent_points[i];
+			l.v1 = R_inv * (t.v1 - o); l.v2 = R_inv * (t.v2 - o); l.v3 = R_inv * (t.v3 - o); l.n = R_inv * t.n;
+			l.u1 = R_inv * (t.u1 - o); l.u2 = R_inv * (t.u2 - o); l.u3 = R_inv * (t.u3 - o); l.m = R_inv * t.m;
+			local_centers[0] = l1; local_centers[1] = l2; local_centers[2] = l3;
+			local_tangent_points_valid[i] = true;
+		}
+
+		///--- Same choice of side as compute_tangent_point
+		if (dot(camera_ray, t.n) > 0) {
+			std::swap(t.v1, t.u1);
+			std::swap(t.v2, t.u2);
+			std::swap(t.v3, t.u3);
+			std::swap(t.n, t.m);
+		}
 	}
 }
 
@@ -278,32 +376,6 @@ void Model::render_outline() {
 	DebugRenderer::instance().add_arcs(arc_endpoints, arc_centers, arc_radii, Vector3(0.673, 0.286, 0.406));
 }
 
-int Model::compute_rendered_indicator_helper(int row, int col, Vector3 p, int block, int num_rendered_points, bool display,
-	cv::Mat & image, const cv::Mat & sensor_silhouette, Camera * camera) {
-
-	row = camera->height() - row - 1;
-	if (col < 1 || col >= camera->width() || row < 1 || row >= camera->height()) return num_rendered_points;
-
-	if (sensor_silhouette.at<uchar>(row, col) == 255) return num_rendered_points;
-
-	rendered_pixels[num_rendered_points] = row * camera->width() + col;
-	rendered_points[3 * num_rendered_points] = p[0];
-	rendered_points[3 * num_rendered_points + 1] = p[1];
-	rendered_points[3 * num_rendered_points + 2] = p[2];
-	rendered_block_ids[num_rendered_points] = block;
-
-	num_rendered_points++;
-
-	if (display) {
-		image.at<cv::Vec3b>(cv::Point(2 * col - 1, 2 * row - 1)) = cv::Vec3b(200, 200, 0);
-		image.at<cv::Vec3b>(cv::Point(2 * col - 1, 2 * row)) = cv::Vec3b(200, 200, 0);
-		image.at<cv::Vec3b>(cv::Point(2 * col, 2 * row - 1)) = cv::Vec3b(200, 200, 0);
-		image.at<cv::Vec3b>(cv::Point(2 * col, 2 * row)) = cv::Vec3b(200, 200, 0);
-	}
-
-	return num_rendered_points;
-}
-
 void Model::compute_rendered_indicator(const cv::Mat & sensor_silhouette, Camera * camera) {
 	bool display = false;
 	cv::Mat image;
@@ -314,71 +386,114 @@ void Model::compute_rendered_indicator(const cv::Mat & sensor_silhouette, Camera
 		cv::resize(image, image, cv::Size(640, 480));
 	}
 
-	num_rendered_points = 0;
-	for (size_t i = 0; i < outline_finder.outline3D.size(); i++) {
-		glm::vec3 s_glm = outline_finder.outline3D[i].start;
-		glm::vec3 e_glm = outline_finder.outline3D[i].end;
-		Vector3 s = Vector3(s_glm[0], s_glm[1], s_glm[2]);
-		Vector3 e = Vector3(e_glm[0], e_glm[1], e_glm[2]);
-		int block = outline_finder.outline3D[i].block;
-		if (outline_finder.outline3D[i].indices[1] != RAND_MAX) {
-			Vector2 s_image = camera->world_to_image(s);
+	///--- Number of samples of each segment and arc, about 1.2 per pixel
+	const std::vector<Outline3D> & outline = outline_finder.outline3D;
+	std::vector<int> & num_samples = outline_num_samples;
+	num_samples.resize(outline.size());
+	int num_outline_samples = 0;
+	for (size_t i = 0; i < outline.size(); i++) {
+		Vector3 s = Vector3(outline[i].start[0], outline[i].start[1], outline[i].start[2]);
+		Vector3 e = Vector3(outline[i].end[0], outline[i].end[1], outline[i].end[2]);
+		if (outline[i].indices[1] != RAND_MAX) {
+			num_samples[i] = 1.2 * (camera->world_to_image(e) - camera->world_to_image(s)).norm();
+		}
+		else {
+			glm::vec3 c_glm = centers[outline[i].indices[0]];
+			Vector3 c = Vector3(c_glm[0], c_glm[1], c_glm[2]);
+			Vector3 v1 = s - c;
+			Vector3 v2 = e - c;
+			float alpha = atan2(v1[0], v1[1]);
+			float beta = atan2(v2[0], v2[1]);
+			if (beta > alpha) alpha = alpha + 2 * M_PI;
+			num_samples[i] = 1.2 * (alpha - beta) * (camera->world_to_image(c) - camera->world_to_image(s)).norm();
+		}
+		num_samples[i] = std::max(num_samples[i], 0);
+		num_outline_samples += num_samples[i];
+	}
+	if (outline_samples.rows() < num_outline_samples) outline_samples.resize(2 * num_outline_samples, Eigen::NoChange);
+	outline_samples_block.resize(num_outline_samples);
+
+	///--- Image and world position of the samples, a primitive at a time
+	int offset = 0;
+	for (size_t i = 0; i < outline.size(); i++) {
+		int n = num_samples[i];
+		if (n == 0) continue;
+		auto x = outline_samples.col(0).segment(offset, n);
+		auto y = outline_samples.col(1).segment(offset, n);
+		auto X = outline_samples.col(2).segment(offset, n);
+		auto Y = outline_samples.col(3).segment(offset, n);
+		auto Z = outline_samples.col(4).segment(offset, n);
+		std::fill(outline_samples_block.begin() + offset, outline_samples_block.begin() + offset + n, (int)outline[i].block);
+
+		Vector3 s = Vector3(outline[i].start[0], outline[i].start[1], outline[i].start[2]);
+		Vector3 e = Vector3(outline[i].end[0], outline[i].end[1], outline[i].end[2]);
+		Vector2 s_image = camera->world_to_image(s);
+		if (outline[i].indices[1] != RAND_MAX) {
 			Vector2 e_image = camera->world_to_image(e);
-
-			float x1 = s_image[0]; float y1 = s_image[1]; 
-			float x2 = e_image[0]; float y2 = e_image[1];
-			float X1 = s[0]; float Y1 = s[1]; float Z1 = s[2];
-			float X2 = e[0]; float Y2 = e[1]; float Z2 = e[2];
-			int num_samples = 1.2 * (e_image - s_image).norm();
-			for (int n = 0; n < num_samples; n++) {
-				float t = (float)n / (num_samples - 1);
-				float x = x1 + t * (x2 - x1);
-				float y = y1 + t * (y2 - y1);
-				Vector3 p = Vector3(X1 + t * (X2 - X1), Y1 + t * (Y2 - Y1), Z1 + t * (Z2 - Z1));
-				int col = (int)x;
-				int row = (int)y;
-				num_rendered_points = compute_rendered_indicator_helper(row, col, p, block, num_rendered_points, display, image, sensor_silhouette, camera);
-			}
+			Z = Eigen::ArrayXf::LinSpaced(n, 0, n - 1) / (float)std::max(n - 1, 1); ///< t, overwritten last
+			x = s_image[0] + Z * (e_image[0] - s_image[0]);
+			y = s_image[1] + Z * (e_image[1] - s_image[1]);
+			X = s[0] + Z * (e[0] - s[0]);
+			Y = s[1] + Z * (e[1] - s[1]);
+			Z = s[2] + Z * (e[2] - s[2]);
 		}
 		else {
-			glm::vec3 c_glm = centers[outline_finder.outline3D[i].indices[0]];
-			float r = radii[outline_finder.outline3D[i].indices[0]];
+			glm::vec3 c_glm = centers[outline[i].indices[0]];
+			float r = radii[outline[i].indices[0]];
 			Vector3 c = Vector3(c_glm[0], c_glm[1], c_glm[2]);
 			Vector2 c_image = camera->world_to_image(c);
-			Vector2 s_image = camera->world_to_image(s);
 			float r_image = (c_image - s_image).norm();
 			Vector3 v1 = s - c;
 			Vector3 v2 = e - c;
-
-			float phi;
-			Vector2 u = Vector2(1, 0); Vector2 v = Vector2(0, 1);
-			Vector3 U = Vector3(1, 0, 0); Vector3 V = Vector3(0, 1, 0);
-
 			float alpha = atan2(v1[0], v1[1]);
 			float beta = atan2(v2[0], v2[1]);
 			if (beta > alpha) alpha = alpha + 2 * M_PI;
-			int num_samples = 1.2 * (alpha - beta) * r_image;
-			for (int n = 0; n < num_samples; n++) {
-				phi = alpha + n * (beta - alpha) / (num_samples - 1);
-				Vector2 x = c_image + r_image * (u * sin(phi) + v * cos(phi));
-				Vector3 p = c + r * (U * sin(phi) + V * cos(phi));
-				int col = (int)x[0];
-				int row = (int)x[1];
-				num_rendered_points = compute_rendered_indicator_helper(row, col, p, block, num_rendered_points, display, image, sensor_silhouette, camera);
+
+			///--- sin and cos of the angles by rotations of a fixed step, in double so that they do not drift
+			double step = (beta - alpha) / std::max(n - 1, 1);
+			double sin_step = sin(step), cos_step = cos(step);
+			double sin_phi = sin(alpha), cos_phi = cos(alpha);
+			for (int k = 0; k < n; k++) {
+				x[k] = sin_phi;
+				y[k] = cos_phi;
+				double sin_next = sin_phi * cos_step + cos_phi * sin_step;
+				cos_phi = cos_phi * cos_step - sin_phi * sin_step;
+				sin_phi = sin_next;
 			}
+			X = c[0] + r * x;
+			Y = c[1] + r * y;
+			Z.setConstant(c[2]);
+			x = c_image[0] + r_image * x;
+			y = c_image[1] + r_image * y;
 		}
+		offset += n;
 	}
-	if (display) cv::imshow("sensor_silhouette", image);	
-	/*num_rendered_points = 0;
-	for (int row = 0; row < rendered_silhouette.rows; ++row) {
-		for (int col = 0; col < rendered_silhouette.cols; ++col) {
-			if (rendered_silhouette.at<uchar>(row, col) != 255 && sensor_silhouette.at<uchar>(row, col) != 255) {
-				rendered_indicator[num_rendered_points] = row * camera->width() + col;
-				num_rendered_points++;
-			}
-		}
-	}*/
 
+	///--- Keep the samples outside of the sensor silhouette, straight into the buffers of the push term
+	num_rendered_points = 0;
+	int width = camera->width();
+	int height = camera->height();
+	for (int k = 0; k < num_outline_samples && num_rendered_points < upper_bound_num_rendered_outline_points; k++) {
+		int col = (int)outline_samples(k, 0);
+		int row = height - (int)outline_samples(k, 1) - 1;
+		if (col < 1 || col >= width || row < 1 || row >= height) continue;
+		if (sensor_silhouette.at<uchar>(row, col) == 255) continue;
+
+		rendered_pixels[num_rendered_points] = row * width + col;
+		rendered_points[3 * num_rendered_points] = outline_samples(k, 2);
+		rendered_points[3 * num_rendered_points + 1] = outline_samples(k, 3);
+		rendered_points[3 * num_rendered_points + 2] = outline_samples(k, 4);
+		rendered_block_ids[num_rendered_points] = outline_samples_block[k];
+		num_rendered_points++;
+
+		if (display) {
+			image.at<cv::Vec3b>(cv::Point(2 * col - 1, 2 * row - 1)) = cv::Vec3b(200, 200, 0);
+			image.at<cv::Vec3b>(cv::Point(2 * col - 1, 2 * row)) = cv::Vec3b(200, 200, 0);
+			image.at<cv::Vec3b>(cv::Point(2 * col, 2 * row - 1)) = cv::Vec3b(200, 200, 0);
+			image.at<cv::Vec3b>(cv::Point(2 * col, 2 * row)) = cv::Vec3b(200, 200, 0);
+		}
+	}
+	if (display) cv::imshow("sensor_silhouette", image);
 }
 
 void Model::write_model(std::string data_path, int frame_number) {
@@ -436,7 +551,6 @@ void Model::write_model(std::string data_path, int frame_number) {
 void Model::load_model_from_file() {
 	blocks.clear();
 
-	std::string model_folder_path = "models/anastasia/";
 	read_float_matrix(data_path + model_folder_path, "C", centers);
 	read_float_vector(data_path + model_folder_path, "R", radii);
 	read_int_matrix(data_path + model_folder_path, "B", blocks);
@@ -461,10 +575,79 @@ void Model::load_model_from_file() {
 		}*/
 }
 
+bool Model::load_model_from_bundle(std::string filename) {
+	ModelBundle loaded;
+	if (!loaded.open(filename)) return false;
+
+	int rows[4], num_centers, num_radii, num_blocks, num_transformations;
+	const float * C = loaded.floats("centers", rows[0], num_centers);
+	const float * R = loaded.floats("radii", rows[1], num_radii);
+	const int * B = loaded.ints("blocks", rows[2], num_blocks);
+	const float * I = loaded.floats("init_transformations", rows[3], num_transformations);
+	if (!C || !R || !B || !I || rows[0] != 3 || rows[1] != 1 || rows[2] != 3 || rows[3] != 16) {
+		cout << "incomplete model bundle " << filename << endl;
+		return false;
+	}
+
+	///--- One radius per center, blocks of existing centers (RAND_MAX for no third one), one transformation per phalange
+	bool consistent = num_radii == num_centers && num_transformations == num_phalanges;
+	for (int i = 0; consistent && i < 3 * num_blocks; i++)
+		consistent = B[i] == RAND_MAX || (B[i] >= 0 && B[i] < num_centers);
+	if (!consistent) {
+		cout << "inconsistent model bundle " << filename << endl;
+		return false;
+	}
+	bundle.swap(loaded); ///< the previous one is closed with loaded
+
+	///--- Same layout as the vectors, see ModelSerializer
+	centers.assign((const glm::vec3 *)C, (const glm::vec3 *)C + num_centers);
+	radii.assign(R, R + num_radii);
+	blocks.assign((const glm::ivec3 *)B, (const glm::ivec3 *)B + num_blocks);
+	for (int i = 0; i < num_transformations; ++i)
+		phalanges[i].init_local = Eigen::Map<const Mat4f>(I + 16 * i);
+	return true;
+}
+
+bool Model::write_model_bundle(std::string filename) {
+	ModelBundle output;
+	output.add("centers", (const float *)centers.data(), 3, centers.size());
+	output.add("radii", radii.data(), 1, radii.size());
+	output.add("blocks", (const int *)blocks.data(), 3, blocks.size());
+
+	std::vector<float> transformations(16 * num_phalanges);
+	for (size_t i = 0; i < num_phalanges; i++)
+		std::copy(phalanges[i].init_local.data(), phalanges[i].init_local.data() + 16, transformations.begin() + 16 * i);
+	output.add("init_transformations", transformations.data(), 16, num_phalanges);
+
+	std::vector<float> dof_limits = get_dof_limits(dofs);
+	output.add("dof_limits", dof_limits.data(), 2, num_thetas);
+
+	if (bundle.is_open()) output.add(bundle, "pose_space/");
+
+	///--- The bundle in use cannot be written over while it is mapped
+	bool reopen = bundle.is_open() && bundle.filename() == filename;
+	if (reopen) bundle.close();
+	bool written = output.write(filename);
+	if (reopen) bundle.open(filename);
+	return written;
+}
+
+bool Model::convert_text_model() {
+	std::string model_path = data_path + model_folder_path;
+	std::string bundle_path = model_path + "model.hmb";
+
+	///--- The bundle in use cannot be written over while it is mapped
+	bool reopen = bundle.is_open() && bundle.filename() == bundle_path;
+	if (reopen) bundle.close();
+	bool written = ::convert_text_model(model_path, data_path + "pose_space/", get_dof_limits(dofs), bundle_path);
+	if (reopen) bundle.open(bundle_path);
+	return written;
+}
+
 // Inverse kinematics
 
-Matrix_3xN Model::jacobian(const Vector3 & s, size_t id) {
-	Matrix_3xN J = Matrix_3xN::Zero(d, num_thetas);
+Matrix_3xTheta Model::jacobian(const Vector3 & s, size_t id) {
+	Matrix_3xTheta J = Matrix_3xTheta::Zero();
 	for (size_t i = 0; i < phalanges[id].kinematic_chain.size(); i++) {
 		size_t dof_id = phalanges[id].kinematic_chain[i];
 		size_t phalange_id = dofs[dof_id].phalange_id;
@@ -492,114 +675,59 @@ Matrix_3xN Model::jacobian(const Vector3 & s, size_t id) {
 	return J;
 }
 
-void Model::update(Phalange & phalange) {
-	if (phalange.parent_id >= 0)
-		phalange.global = phalanges[phalange.parent_id].global * phalange.local;
-	else  phalange.global = phalange.local;
-	for (size_t i = 0; i < phalange.children_ids.size(); i++)  update(phalanges[phalange.children_ids[i]]);
-}
-
-void Model::translate(Phalange & phalange, const Vec3f & t) {
-	phalange.local(0, 3) += t[0];
-	phalange.local(1, 3) += t[1];
-	phalange.local(2, 3) += t[2];
-	update(phalange);
-	//cout << phalange.local << endl;
-}
-
-void Model::rotate(Phalange & phalange, const Vec3f &axis, float angle) {
-	phalange.local = phalange.local * Transform3f(Eigen::AngleAxisf(angle, axis)).matrix();
-	update(phalange);
-}
-
-void Model::transform_joints(const std::vector<float> & theta) {
-	//cout << "transform_joints" << endl;	
-
-	for (size_t i = 0; i < dofs.size(); ++i) {
-		if (dofs[i].phalange_id == -1) continue;
-		switch (dofs[i].type) {
-		case TRANSLATION_AXIS:
-			translate(phalanges[dofs[i].phalange_id], dofs[i].axis * theta[i]);
-			break;
-		case ROTATION_AXIS:
-			rotate(phalanges[dofs[i].phalange_id], dofs[i].axis, theta[i]);
-			break;
-		}
-	}
-}
-
 void Model::move(const std::vector<float> & theta) {
 	for (size_t i = 0; i < num_thetas; i++) {
 		this->theta[i] = theta[i];
 	}
-	for (size_t i = 0; i < num_phalanges + 1; i++) {
-		phalanges[i].local = phalanges[i].init_local;
-	}
-
-	//cout << "move" << endl;
-	vector<float> rotateX(num_thetas, 0); // flexion
-	vector<float> rotateZ(num_thetas, 0); // abduction
-	vector<float> rotateY(num_thetas, 0); // twist
-	vector<float> globals(num_thetas, 0); // pose
-
-	for (size_t i = 0; i < num_thetas; ++i) {
-		if (dofs[i].phalange_id < num_phalanges && dofs[i].type == ROTATION_AXIS) {
-			if (dofs[i].axis == Vec3f(1, 0, 0))
-				rotateX[i] = theta[i];
-			else if (dofs[i].axis == Vec3f(0, 1, 0))
-				rotateY[i] = theta[i];
-			else if (dofs[i].axis == Vec3f(0, 0, 1))
-				rotateZ[i] = theta[i];
-			else
-				cout << "wrong axis" << endl;
 
-		}
-		else
-			globals[i] = theta[i];
+	Mat4f locals[num_phalanges + 1];
+	Mat4f globals[num_phalanges + 1];
+	forward_kinematics.compute(this->theta.data(), locals, globals);
+	for (size_t i = 0; i < num_phalanges + 1; i++) {
+		phalanges[i].local = locals[i];
+		phalanges[i].global = globals[i];
 	}
+}
 
-	//transform joints separately
-	transform_joints(globals); // pose	
-	transform_joints(rotateX); // flexion
-	transform_joints(rotateZ); // abduction
-	transform_joints(rotateY); // twist
+void Model::evaluate(const std::vector<float> & theta, PoseGeometry & geometry, bool with_tangent_points) const {
+	geometry.locals.resize(num_phalanges + 1);
+	geometry.globals.resize(num_phalanges + 1);
+	forward_kinematics.compute(theta.data(), geometry.locals.data(), geometry.globals.data());
+	compute_centers(geometry.globals.data(), geometry.centers);
+	if (with_tangent_points) compute_tangent_points(geometry.centers, geometry.tangent_points);
 }
 
-void Model::update_centers() {
+void Model::compute_centers(const Mat4f * globals, std::vector<glm::vec3> & centers) const {
+	centers = this->centers; ///< for the centers not attached to any phalange
 	for (size_t i = 0; i < num_phalanges; i++) {
-		Vec3f p = phalanges[i].global.block(0, 3, 3, 1);
+		Vec3f p = globals[i].block(0, 3, 3, 1);
 		centers[phalanges[i].center_id] = glm::vec3(p[0], p[1], p[2]);
-
-		/*//cout << endl << phalanges[i].global.block(0, 3, 3, 1).transpose() << endl;
-		cout << endl << endl << endl << "i = " << i << endl;
-		cout << "name = " << phalanges[i].name << endl;
-		cout << "center_id = " << phalanges[i].center_id << endl;
-		cout << " center = " << centers[phalanges[i].center_id][0] << ", " << centers[phalanges[i].center_id][1] << ", " << centers[phalanges[i].center_id][2] << endl;
-		//cout << phalanges[i].global << endl << endl;*/
-
 		for (size_t j = 0; j < phalanges[i].attachments.size(); j++) {
-			Vec3d t = phalanges[i].global.block(0, 0, 3, 3).cast<double>() * phalanges[i].offsets[j];
+			Vec3d t = globals[i].block(0, 0, 3, 3).cast<double>() * phalanges[i].offsets[j];
 			centers[phalanges[i].attachments[j]] = glm::vec3(p[0], p[1], p[2]) + glm::vec3(t[0], t[1], t[2]);
-
-			/*cout << endl << "attachment_id = " << phalanges[i].attachments[j] << endl;
-			cout << "offset = " << phalanges[i].offsets[j][0] << ", " << phalanges[i].offsets[j][1] << ", " << phalanges[i].offsets[j][2] << endl;
-			cout << " center = " << centers[phalanges[i].attachments[j]][0] << ", " << centers[phalanges[i].attachments[j]][1] << ", " << centers[phalanges[i].attachments[j]][2] << endl;
-			//cout << "R = " << phalanges[i].global.block(0, 0, 3, 3) << endl;
-			//cout << "p = " << p[0] << ", " << p[1] << ", " << p[2] << endl;
-			cout << "t = " << t[0] << ", " << t[1] << ", " << t[2] << endl;*/
-
 		}
 	}
-	reindex();
-	compute_tangent_points();
+}
+
+void Model::update_centers() {
+	Mat4f globals[num_phalanges];
+	for (size_t i = 0; i < num_phalanges; i++) globals[i] = phalanges[i].global;
+	compute_centers(globals, centers);
+	update_tangent_points(); ///< the radius ordering of the blocks (reindex) only changes with the radii
 }
 
 std::vector<float> Model::get_updated_parameters(const vector<float> & theta, const vector<float> &delta_theta) {
+	std::vector<float> updated(num_thetas);
+	get_updated_parameters(theta, delta_theta, updated);
+	return updated;
+}
+
+void Model::get_updated_parameters(const vector<float> & theta, const vector<float> &delta_theta, vector<float> & updated) {
 	size_t rx = 3;
 	size_t ry = 4;
 	size_t rz = 5;
 
-	std::vector<float> updated(num_thetas);
+	updated.resize(num_thetas);
 	for (size_t i = 0; i < num_thetas; ++i)
 		updated[i] = theta[i] + (i < delta_theta.size() ? delta_theta[i] : 0);
 
@@ -620,8 +748,6 @@ std::vector<float> Model::get_updated_parameters(const vector<float> & theta, co
 	updated[rx] = e[0];
 	updated[ry] = e[1];
 	updated[rz] = e[2];
-
-	return updated;
 }
 
 const std::vector<float>& Model::get_theta() {
@@ -719,4 +845,5 @@ void Model::resize_model(float uniform_scaling_factor, float width_scaling_facto
 			phalanges[i].offsets[j] = scaling_matrix * phalanges[i].offsets[j];
 		}
 	}
+	reindex();
 }
\ No newline at end of file
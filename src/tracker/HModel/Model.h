@@ -8,6 +8,8 @@
 #include "OutlineFinder.h"
 #include "ModelSerializer.h"
 #include "ModelSemantics.h"
+#include "ForwardKinematics.h"
+#include "ModelBundle.h"
 
 #include "opencv2/core/core.hpp"       ///< cv::Mat
 #include "opencv2/highgui/highgui.hpp" ///< cv::imShow
@@ -56,6 +58,15 @@ struct Tangent {
 	}
 };
 
+/// Geometry of the model at a given pose, see Model::evaluate
+/// @note owned by the caller, so that poses can be evaluated without touching (or locking) the model
+struct PoseGeometry {
+	aligned_vector<Mat4f>::type locals; ///< indexed by phalange id
+	aligned_vector<Mat4f>::type globals; ///< indexed by phalange id
+	std::vector<glm::vec3> centers;
+	std::vector<Tangent> tangent_points;
+};
+
 class Model {
 public:
 	int num_tangent_fields = 8;
@@ -67,6 +78,14 @@ public:
 	std::vector<glm::ivec3> blocks;
 	std::vector<Tangent> tangent_points;
 
+	///--- Tangent points of each block in the frame of the phalange of its first center, see update_tangent_points
+	std::vector<int> centerid_to_phalangeid; ///< -1 if the center is not attached to any phalange
+	std::vector<Tangent> local_tangent_points;
+	std::vector<glm::vec3> local_block_centers; ///< 3 per block, the centers local_tangent_points were computed from
+	std::vector<bool> local_tangent_points_valid;
+	float tangent_points_tolerance = 1e-4f; ///< displacement (mm) of the local centers below which a block is only moved rigidly
+
+	///--- Raw views of the vectors above, see ModelSerializer (only the outline is a copy)
 	float * host_pointer_centers;
 	float * host_pointer_radii;
 	int * host_pointer_blocks;
@@ -88,12 +107,17 @@ public:
 	OutlineFinder outline_finder;
 	ModelSerializer serializer;
 	ModelSemantics semantics;
+	ForwardKinematics forward_kinematics;
+	ModelBundle bundle; ///< kept mapped, the pose prior is read from it too (see PoseSpace::init)
 	KinematicChain kinematic_chain;
 	JointTransformations transformations;
 	int * rendered_pixels;
 	float * rendered_points;
 	int * rendered_block_ids;
 	int num_rendered_points;
+	Eigen::Array<float, Eigen::Dynamic, 5> outline_samples; ///< image x, y and world x, y, z of all the samples of the outline, before the silhouette test
+	std::vector<int> outline_samples_block;
+	std::vector<int> outline_num_samples; ///< of each segment and arc of the outline
 
 	std::vector<float> theta;
 	std::vector<Phalange> phalanges;
@@ -122,43 +146,51 @@ public:
 
 	void compute_outline();
 
-	void compute_tangent_point(const glm::vec3 & camera_ray, glm::vec3 & c1, const glm::vec3 & c2, const glm::vec3 & c3, float r1, float r2, float r3,
-		glm::vec3 & v1, glm::vec3 & v2, glm::vec3 & v3, glm::vec3 & u1, glm::vec3 & u2, glm::vec3 & u3, glm::vec3 & n, glm::vec3 & m);
+	void compute_tangent_point(const glm::vec3 & camera_ray, const glm::vec3 & c1, const glm::vec3 & c2, const glm::vec3 & c3, float r1, float r2, float r3,
+		glm::vec3 & v1, glm::vec3 & v2, glm::vec3 & v3, glm::vec3 & u1, glm::vec3 & u2, glm::vec3 & u3, glm::vec3 & n, glm::vec3 & m) const;
 
 	void compute_tangent_points();
 
+	/// Same as compute_tangent_points, but the blocks that moved rigidly with their phalange are only transformed
+	void update_tangent_points();
+
+	void compute_tangent_points(const std::vector<glm::vec3> & centers, std::vector<Tangent> & tangent_points) const;
+
+	/// @param globals phalange transformations, indexed by phalange id
+	void compute_centers(const Mat4f * globals, std::vector<glm::vec3> & centers) const;
+
 	void print_model();
 
 	void render_outline();
 
-	int compute_rendered_indicator_helper(int row, int col, Vector3 p, int block, int num_rendered_points, bool display,
-		cv::Mat & image, const cv::Mat & sensor_silhouette, Camera * camera);
-
 	void compute_rendered_indicator(const cv::Mat & sensor_silhouette, Camera * camera);
 
 	void write_model(std::string data_path, int frame_number = 0);
 
 	void load_model_from_file();
 
+	/// Same content as write_model, plus the dof limits and the pose prior of the current bundle, in a single binary file
+	bool write_model_bundle(std::string filename);
+
+	/// Converts the text model and the pose prior of data_path to the bundle init loads (model.hmb next to the text
+	/// model). Explicit step (see convert_model in demo/main.cpp), init itself never writes the bundle.
+	bool convert_text_model();
+
 	void resize_model(float uniform_scaling_factor, float width_scaling_factor, float thickness_scaling_factor);
 
 	void update_centers();
 
-	Matrix_3xN jacobian(const Vector3 & s, size_t id);
+	Matrix_3xTheta jacobian(const Vector3 & s, size_t id);
 
 	void move(const std::vector<float> & theta);
 
-	void transform_joints(const std::vector<float> & theta);
-
-	void Model::update(Phalange & phalange);
-
-	void Model::translate(Phalange & phalange, const Vec3f & t);
-
-	void Model::rotate(Phalange & phalange, const Vec3f &axis, float angle);
+	/// Same as move + update_centers, but into the caller's buffer: the model is left untouched
+	void evaluate(const std::vector<float> & theta, PoseGeometry & geometry, bool with_tangent_points = true) const;
 
 	const std::vector<float>& Model::get_theta();
 
 	std::vector<float> Model::get_updated_parameters(const vector<float> & theta, const vector<float> &delta_theta);
+	void get_updated_parameters(const vector<float> & theta, const vector<float> & delta_theta, vector<float> & updated); ///< updated may be theta
 
 	Vec3f get_palm_center();
 
@@ -167,4 +199,11 @@ public:
 	Mat3f build_rotation_matrix(Vec3f euler_angles);
 
 	void manually_adjust_initial_transformations();
+
+private:
+	/// Centers, radii, blocks and initial transformations from a bundle written by write_model_bundle or convert_text_model
+	/// @note init only, which then sets up the semantics, dof limits, kinematics and offsets from them
+	/// @return false if the file is missing, lacks one of them or they do not match (one radius per center, block indices
+	/// of existing centers, one transformation per phalange), the model (and its bundle) is then left untouched
+	bool load_model_from_bundle(std::string filename);
 };
\ No newline at end of file
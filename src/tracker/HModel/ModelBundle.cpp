@@ -0,0 +1,271 @@
+#include "ModelBundle.h"
+#include <cstring>
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <algorithm>
+
+#include <sys/types.h>
+#include <sys/stat.h>
+
+#ifdef _WIN32
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <sys/mman.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+namespace {
+const char magic[4] = { 'H', 'M', 'B', 0 };
+const size_t alignment = 64;
+
+size_t align(size_t offset) {
+	return (offset + alignment - 1) / alignment * alignment;
+}
+
+size_t element_size(uint32_t type) {
+	return type == ModelBundle::INT ? sizeof(int) : sizeof(float);
+}
+}
+
+ModelBundle::~ModelBundle() {
+	close();
+}
+
+bool ModelBundle::open(const std::string & filename) {
+	close();
+
+#ifdef _WIN32
+	HANDLE file = CreateFileA(filename.c_str(), GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+	if (file == INVALID_HANDLE_VALUE) return false;
+	LARGE_INTEGER size;
+	HANDLE mapping = NULL;
+	if (GetFileSizeEx(file, &size) && size.QuadPart > 0)
+		mapping = CreateFileMappingA(file, NULL, PAGE_READONLY, 0, 0, NULL);
+	if (!mapping) { CloseHandle(file); return false; }
+	mapped = (const char *)MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+	if (!mapped) { CloseHandle(mapping); CloseHandle(file); return false; }
+	file_handle = file;
+	mapping_handle = mapping;
+	mapped_size = (size_t)size.QuadPart;
+#else
+	int file = ::open(filename.c_str(), O_RDONLY);
+	if (file < 0) return false;
+	struct stat status;
+	if (fstat(file, &status) != 0 || status.st_size == 0) { ::close(file); return false; }
+	void * view = mmap(NULL, status.st_size, PROT_READ, MAP_PRIVATE, file, 0);
+	::close(file); ///< the mapping keeps the file alive
+	if (view == MAP_FAILED) return false;
+	mapped = (const char *)view;
+	mapped_size = status.st_size;
+#endif
+
+	///--- Validate the header and the section table
+	const Header * header = (const Header *)mapped;
+	bool valid = mapped_size >= sizeof(Header)
+		&& std::memcmp(header->magic, magic, sizeof(magic)) == 0
+		&& header->version == version
+		&& mapped_size >= sizeof(Header) + header->num_sections * sizeof(Section);
+	if (valid) {
+		sections = (const Section *)(mapped + sizeof(Header));
+		num_sections = header->num_sections;
+		for (uint32_t i = 0; i < num_sections && valid; i++) {
+			const Section & section = sections[i];
+			size_t size = (size_t)section.rows * section.cols * element_size(section.type);
+			valid = section.name[sizeof(section.name) - 1] == 0 && section.type <= INT
+				&& section.offset % alignment == 0 && section.offset + size <= mapped_size;
+		}
+	}
+	if (!valid) {
+		std::cout << "invalid model bundle " << filename << std::endl;
+		close();
+		return false;
+	}
+	path = filename;
+	return true;
+}
+
+void ModelBundle::swap(ModelBundle & other) {
+	std::swap(mapped, other.mapped);
+	std::swap(mapped_size, other.mapped_size);
+#ifdef _WIN32
+	std::swap(file_handle, other.file_handle);
+	std::swap(mapping_handle, other.mapping_handle);
+#endif
+	std::swap(sections, other.sections);
+	std::swap(num_sections, other.num_sections);
+	path.swap(other.path);
+	pending_sections.swap(other.pending_sections);
+	pending_data.swap(other.pending_data);
+}
+
+void ModelBundle::close() {
+	if (mapped) {
+#ifdef _WIN32
+		UnmapViewOfFile(mapped);
+		CloseHandle(mapping_handle);
+		CloseHandle(file_handle);
+		mapping_handle = file_handle = NULL;
+#else
+		munmap((void *)mapped, mapped_size);
+#endif
+	}
+	mapped = NULL;
+	mapped_size = 0;
+	sections = NULL;
+	num_sections = 0;
+	path.clear();
+}
+
+const ModelBundle::Section * ModelBundle::find(const std::string & name, Type type) const {
+	for (uint32_t i = 0; i < num_sections; i++)
+		if (sections[i].type == type && name == sections[i].name) return &sections[i];
+	return NULL;
+}
+
+const float * ModelBundle::floats(const std::string & name, int & rows, int & cols) const {
+	const Section * section = find(name, FLOAT);
+	if (!section) return NULL;
+	rows = section->rows;
+	cols = section->cols;
+	return (const float *)(mapped + section->offset);
+}
+
+const int * ModelBundle::ints(const std::string & name, int & rows, int & cols) const {
+	const Section * section = find(name, INT);
+	if (!section) return NULL;
+	rows = section->rows;
+	cols = section->cols;
+	return (const int *)(mapped + section->offset);
+}
+
+void ModelBundle::add(const std::string & name, Type type, const void * data, int rows, int cols) {
+	Section section;
+	std::memset(&section, 0, sizeof(Section));
+	std::strncpy(section.name, name.c_str(), sizeof(section.name) - 1);
+	section.type = type;
+	section.rows = rows;
+	section.cols = cols;
+	pending_sections.push_back(section);
+	const char * bytes = (const char *)data;
+	pending_data.push_back(std::vector<char>(bytes, bytes + (size_t)rows * cols * element_size(type)));
+}
+
+void ModelBundle::add(const ModelBundle & other, const std::string & prefix) {
+	for (uint32_t i = 0; i < other.num_sections; i++) {
+		const Section & section = other.sections[i];
+		if (std::strncmp(section.name, prefix.c_str(), prefix.size()) != 0) continue;
+		add(section.name, (Type)section.type, other.mapped + section.offset, section.rows, section.cols);
+	}
+}
+
+bool ModelBundle::write(const std::string & filename) const {
+	Header header;
+	std::memcpy(header.magic, magic, sizeof(magic));
+	header.version = version;
+	header.num_sections = pending_sections.size();
+	header.reserved = 0;
+
+	std::vector<Section> table = pending_sections;
+	size_t offset = align(sizeof(Header) + table.size() * sizeof(Section));
+	for (size_t i = 0; i < table.size(); i++) {
+		table[i].offset = offset;
+		offset = align(offset + pending_data[i].size());
+	}
+
+	std::ofstream out(filename, std::ios::out | std::ios::binary | std::ios::trunc);
+	if (!out) return false;
+	const char padding[alignment] = {};
+	out.write((const char *)&header, sizeof(Header));
+	out.write((const char *)table.data(), table.size() * sizeof(Section));
+	size_t position = sizeof(Header) + table.size() * sizeof(Section);
+	for (size_t i = 0; i < table.size(); i++) {
+		out.write(padding, table[i].offset - position);
+		out.write(pending_data[i].data(), pending_data[i].size());
+		position = table[i].offset + pending_data[i].size();
+	}
+	out.write(padding, align(position) - position);
+	return out.good();
+}
+
+namespace {
+/// Text array as written by Model::write_model: the number of entries, then the values
+bool read_text(const std::string & filename, int entry_size, std::vector<float> & values, int & num_entries) {
+	FILE * fp = fopen(filename.c_str(), "r");
+	if (!fp) return false;
+	bool valid = fscanf(fp, "%d", &num_entries) == 1 && num_entries >= 0;
+	if (valid) values.resize(num_entries * entry_size);
+	for (size_t i = 0; valid && i < values.size(); i++)
+		valid = fscanf(fp, "%f", &values[i]) == 1;
+	fclose(fp);
+	return valid;
+}
+
+const char * text_names[] = { "C.txt", "R.txt", "B.txt", "I.txt" };
+const char * pose_space_names[] = { "mu", "P", "Sigma", "Limits", "thumb/P", "thumb/Sigma", "thumb/Limits", "fingers/P", "fingers/Sigma", "fingers/Limits" };
+
+/// Seconds since the epoch, -1 if the file does not exist
+long long modification_time(const std::string & filename) {
+#ifdef _WIN32
+	struct _stat64 status;
+	if (_stat64(filename.c_str(), &status) != 0) return -1;
+#else
+	struct stat status;
+	if (stat(filename.c_str(), &status) != 0) return -1;
+#endif
+	return (long long)status.st_mtime;
+}
+
+/// Eigen binary as written by Eigen::write_binary (see PoseSpace.cpp): rows, cols (64 bit), then the values
+bool read_eigen_binary(const std::string & filename, bool is_vector, std::vector<float> & values, int & rows, int & cols) {
+	std::ifstream in(filename, std::ios::in | std::ios::binary);
+	if (!in) return false;
+	int64_t dims[2] = { 0, 1 };
+	in.read((char *)dims, (is_vector ? 1 : 2) * sizeof(int64_t));
+	if (!in || dims[0] < 0 || dims[1] < 0) return false;
+	rows = (int)dims[0];
+	cols = (int)dims[1];
+	values.resize((size_t)rows * cols);
+	in.read((char *)values.data(), values.size() * sizeof(float));
+	return (bool)in;
+}
+}
+
+bool convert_text_model(const std::string & model_path, const std::string & pose_space_path, const std::vector<float> & dof_limits,
+	const std::string & filename) {
+	ModelBundle bundle;
+	std::vector<float> values;
+	int num_entries;
+
+	if (!read_text(model_path + text_names[0], 3, values, num_entries)) return false;
+	bundle.add("centers", values.data(), 3, num_entries);
+	if (!read_text(model_path + text_names[1], 1, values, num_entries)) return false;
+	bundle.add("radii", values.data(), 1, num_entries);
+	if (!read_text(model_path + text_names[2], 3, values, num_entries)) return false;
+	std::vector<int> blocks(values.begin(), values.end());
+	bundle.add("blocks", blocks.data(), 3, num_entries);
+	if (!read_text(model_path + text_names[3], 16, values, num_entries)) return false;
+	bundle.add("init_transformations", values.data(), 16, num_entries); ///< column major 4x4 each
+	bundle.add("dof_limits", dof_limits.data(), 2, (int)dof_limits.size() / 2);
+
+	///--- Pose prior, optional
+	for (size_t i = 0; i < sizeof(pose_space_names) / sizeof(pose_space_names[0]); i++) {
+		int rows, cols;
+		if (read_eigen_binary(pose_space_path + pose_space_names[i], i == 0, values, rows, cols))
+			bundle.add(std::string("pose_space/") + pose_space_names[i], values.data(), rows, cols);
+	}
+	return bundle.write(filename);
+}
+
+bool is_bundle_up_to_date(const std::string & model_path, const std::string & pose_space_path, const std::string & filename) {
+	long long bundle_time = modification_time(filename);
+	if (bundle_time < 0) return false;
+	///--- Strictly newer, a bundle converted in the same second as its sources were written is up to date
+	for (size_t i = 0; i < sizeof(text_names) / sizeof(text_names[0]); i++)
+		if (modification_time(model_path + text_names[i]) > bundle_time) return false;
+	for (size_t i = 0; i < sizeof(pose_space_names) / sizeof(pose_space_names[0]); i++)
+		if (modification_time(pose_space_path + pose_space_names[i]) > bundle_time) return false;
+	return true;
+}
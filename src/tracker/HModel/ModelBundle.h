@@ -0,0 +1,83 @@
+#pragma once
+#include <string>
+#include <vector>
+#include <cstdint>
+
+/// Versioned single-file binary container of named float/int arrays (hand model and pose prior),
+/// read in place through a memory mapping of the file.
+/// @note layout: Header, num_sections Section entries, then the arrays (column major, 64 byte aligned)
+class ModelBundle {
+public:
+	static const uint32_t version = 1;
+	enum Type { FLOAT = 0, INT = 1 };
+
+	struct Header {
+		char magic[4]; ///< "HMB\0"
+		uint32_t version;
+		uint32_t num_sections;
+		uint32_t reserved;
+	};
+
+	struct Section {
+		char name[48];
+		uint32_t type;
+		uint32_t rows;
+		uint32_t cols;
+		uint32_t reserved;
+		uint64_t offset; ///< from the beginning of the file
+	};
+
+private:
+	///--- Reading
+	const char * mapped = NULL;
+	size_t mapped_size = 0;
+#ifdef _WIN32
+	void * file_handle = NULL;
+	void * mapping_handle = NULL;
+#endif
+	const Section * sections = NULL;
+	uint32_t num_sections = 0;
+	std::string path;
+
+	///--- Writing
+	std::vector<Section> pending_sections;
+	std::vector<std::vector<char>> pending_data;
+
+	const Section * find(const std::string & name, Type type) const;
+	void add(const std::string & name, Type type, const void * data, int rows, int cols);
+
+	ModelBundle(const ModelBundle &); ///< owns the mapping, not copyable
+	ModelBundle & operator=(const ModelBundle &);
+
+public:
+	ModelBundle() {}
+	~ModelBundle();
+
+	/// @return false if the file is missing, has another version or is truncated
+	bool open(const std::string & filename);
+	void close();
+	bool is_open() const { return mapped != NULL; }
+	void swap(ModelBundle & other); ///< exchanges the mappings, to replace an open bundle only once the new one is valid
+	const std::string & filename() const { return path; }
+
+	/// Arrays point into the mapping, valid until close()
+	/// @return NULL if there is no section of that name and type
+	const float * floats(const std::string & name, int & rows, int & cols) const;
+	const int * ints(const std::string & name, int & rows, int & cols) const;
+
+	void add(const std::string & name, const float * data, int rows, int cols) { add(name, FLOAT, data, rows, cols); }
+	void add(const std::string & name, const int * data, int rows, int cols) { add(name, INT, data, rows, cols); }
+	/// Copies the sections of an open bundle whose name starts with prefix
+	void add(const ModelBundle & other, const std::string & prefix);
+	bool write(const std::string & filename) const;
+};
+
+/// Converts the text model (C.txt, R.txt, B.txt, I.txt in model_path) and the pose prior binaries
+/// (mu, {thumb,fingers}/{P,Sigma,Limits} in pose_space_path) to a bundle
+/// @param dof_limits min and max of each dof, as set by ModelSemantics::setup_dofs (see Model::convert_text_model)
+bool convert_text_model(const std::string & model_path, const std::string & pose_space_path, const std::vector<float> & dof_limits,
+	const std::string & filename);
+
+/// @return false if the bundle is missing or one of the sources of convert_text_model was modified after it
+/// (a missing source does not count, the bundle can be shipped alone)
+bool is_bundle_up_to_date(const std::string & model_path, const std::string & pose_space_path, const std::string & filename);
@@ -215,6 +215,7 @@ void ModelSemantics::setup_outline() {
 		model->fingers_base_centers.push_back(14);
 		model->fingers_base_centers.push_back(18);
 	}
+	model->outline_finder.reset_parts(); ///< the part outlines are of the previous block indices
 }
 
 void ModelSemantics::setup_centers_name_to_id_map() {
@@ -1,55 +1,29 @@
 #include "ModelSerializer.h"
 #include "Model.h"
+#include <cstddef> ///< offsetof
+
+///--- The model vectors are stored in the layout of the host buffers (d components per element,
+///    the fields of Tangent in the order v1 v2 v3 n u1 u2 u3 m), so they are exposed without copies
+static_assert(sizeof(glm::vec3) == d * sizeof(float), "centers must be packed");
+static_assert(sizeof(glm::ivec3) == d * sizeof(int), "blocks must be packed");
+static_assert(sizeof(Tangent) == 8 * sizeof(glm::vec3), "tangent points must be packed");
+static_assert(offsetof(Tangent, n) == 3 * sizeof(glm::vec3) && offsetof(Tangent, u1) == 4 * sizeof(glm::vec3)
+	&& offsetof(Tangent, m) == 7 * sizeof(glm::vec3), "tangent fields out of order");
 
 void ModelSerializer::serialize_centers() {
-	if (!model->host_pointer_centers)
-		model->host_pointer_centers = new float[d * model->centers.size()];
-	for (size_t i = 0; i < model->centers.size(); i++) {
-		for (size_t j = 0; j < d; j++) {
-			model->host_pointer_centers[d * i + j] = model->centers[i][j];
-		}
-	}
+	model->host_pointer_centers = &model->centers[0][0];
 }
 
 void ModelSerializer::serialize_radii() {
-	if (!model->host_pointer_radii)
-		model->host_pointer_radii = new float[model->radii.size()];
-	for (size_t i = 0; i < model->radii.size(); i++) {
-		model->host_pointer_radii[i] = model->radii[i];
-	}
+	model->host_pointer_radii = model->radii.data();
 }
 
 void ModelSerializer::serialize_blocks() {
-	if (!model->host_pointer_blocks)
-		model->host_pointer_blocks = new int[d * model->blocks.size()];
-	for (size_t i = 0; i < model->blocks.size(); i++) {
-		for (size_t j = 0; j < d; j++) {
-			model->host_pointer_blocks[d * i + j] = model->blocks[i][j];
-		}
-	}
+	model->host_pointer_blocks = &model->blocks[0][0];
 }
 
 void ModelSerializer::serialize_tangent_points() {
-	if (!model->host_pointer_tangent_points)
-		model->host_pointer_tangent_points = new float[d * model->num_tangent_fields * model->tangent_points.size()];
-	for (size_t i = 0; i < model->tangent_points.size(); i++) {
-		for (size_t j = 0; j < d; j++)
-			model->host_pointer_tangent_points[d * model->num_tangent_fields * i + j] = model->tangent_points[i].v1[j];
-		for (size_t j = 0; j < d; j++)
-			model->host_pointer_tangent_points[d * model->num_tangent_fields * i + 3 + j] = model->tangent_points[i].v2[j];
-		for (size_t j = 0; j < d; j++)
-			model->host_pointer_tangent_points[d * model->num_tangent_fields * i + 6 + j] = model->tangent_points[i].v3[j];
-		for (size_t j = 0; j < d; j++)
-			model->host_pointer_tangent_points[d * model->num_tangent_fields * i + 9 + j] = model->tangent_points[i].n[j];
-		for (size_t j = 0; j < d; j++)
-			model->host_pointer_tangent_points[d * model->num_tangent_fields * i + 12 + j] = model->tangent_points[i].u1[j];
-		for (size_t j = 0; j < d; j++)
-			model->host_pointer_tangent_points[d * model->num_tangent_fields * i + 15 + j] = model->tangent_points[i].u2[j];
-		for (size_t j = 0; j < d; j++)
-			model->host_pointer_tangent_points[d * model->num_tangent_fields * i + 18 + j] = model->tangent_points[i].u3[j];
-		for (size_t j = 0; j < d; j++)
-			model->host_pointer_tangent_points[d * model->num_tangent_fields * i + 21 + j] = model->tangent_points[i].m[j];
-	}
+	model->host_pointer_tangent_points = &model->tangent_points[0].v1[0];
 }
 
 void ModelSerializer::serialize_outline() {
@@ -67,11 +41,7 @@ void ModelSerializer::serialize_outline() {
 }
 
 void ModelSerializer::serialize_blockid_to_jointid_map() {
-	if (!model->host_pointer_blockid_to_jointid_map)
-		model->host_pointer_blockid_to_jointid_map = new int[model->blockid_to_jointid_map.size()];
-	for (size_t i = 0; i < model->blockid_to_jointid_map.size(); i++) {
-		model->host_pointer_blockid_to_jointid_map[i] = model->blockid_to_jointid_map[i];
-	}
+	model->host_pointer_blockid_to_jointid_map = model->blockid_to_jointid_map.data();
 }
 
 void ModelSerializer::serialize_transformations() {
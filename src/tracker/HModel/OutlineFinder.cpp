@@ -43,6 +43,20 @@ struct OutlineSegment {
 	size_t block;
 };
 
+/// Axis aligned bounding boxes, to reject the pairs of primitives that cannot intersect
+struct OutlineBox {
+	glm::dvec2 min;
+	glm::dvec2 max;
+	OutlineBox() {}
+	OutlineBox(const glm::dvec2 & c, double r) : min(c - glm::dvec2(r, r)), max(c + glm::dvec2(r, r)) {}
+	OutlineBox(const glm::dvec2 & a, const glm::dvec2 & b) : min(glm::min(a, b)), max(glm::max(a, b)) {}
+	bool overlaps(const OutlineBox & other) const {
+		const double margin = 1e-6; ///< rounding of the intersection points
+		return min[0] <= other.max[0] + margin && other.min[0] <= max[0] + margin &&
+			min[1] <= other.max[1] + margin && other.min[1] <= max[1] + margin;
+	}
+};
+
 struct OutlineTraverser {
 	Model * const model;
 
@@ -50,6 +64,9 @@ struct OutlineTraverser {
 	std::vector<OutlineSegment> segments;
 	std::vector<OutlineCircle> circles;
 	std::vector<Outline> outline;
+	std::vector<std::vector<int>> spare_points; ///< emptied points of the segments of the previous outline, reused
+	std::vector<OutlineBox> circle_boxes;
+	std::vector<OutlineBox> segment_boxes;
 
 	const::std::vector<int> & block_indices;
 
@@ -60,6 +77,23 @@ struct OutlineTraverser {
 		}*/
 	OutlineTraverser(Model * _model, const::std::vector<int> & _block_indices) : model(_model), block_indices(_block_indices) {}
 
+	/// Empties the primitives of the previous outline, keeping their memory
+	void reset() {
+		points.clear();
+		for (size_t i = 0; i < segments.size(); i++) {
+			segments[i].points.clear();
+			spare_points.push_back(std::vector<int>());
+			spare_points.back().swap(segments[i].points);
+		}
+		segments.clear();
+		circles.resize(model->centers.size());
+		for (size_t i = 0; i < circles.size(); i++) {
+			circles[i].points.clear();
+			circles[i].radius = -1;
+		}
+		outline.clear();
+	}
+
 	void print_points() {
 		std::cout << "POINTS" << std::endl;
 		for (size_t i = 0; i < points.size(); i++) {
@@ -155,19 +189,23 @@ struct OutlineTraverser {
 		circles[i2].radius = model->radii[i2];
 		circles[i2].block = b;
 
-		OutlineSegment segment;
+		segments.push_back(OutlineSegment());
+		OutlineSegment & segment = segments.back();
+		if (!spare_points.empty()) {
+			segment.points.swap(spare_points.back());
+			spare_points.pop_back();
+		}
 		segment.t1 = t1;
 		segment.t2 = t2;
 		segment.indices = glm::dvec2(i1, i2);
 		segment.points.push_back(p - 2);
 		segment.points.push_back(p - 1);
 		segment.block = b;
-		segments.push_back(segment);
 	}
 
 	void find_outline_intersections() {
 		debug = false;
-		circles = std::vector<OutlineCircle>(model->centers.size(), OutlineCircle());
+		reset();
 		glm::dvec2 lt1, lt2, rt1, rt2;
 		double d1, d2;
 		
@@ -211,6 +249,13 @@ struct OutlineTraverser {
 			print_circles();
 		}
 
+		circle_boxes.resize(circles.size());
+		for (size_t i = 0; i < circles.size(); i++)
+			if (!circles[i].isempty()) circle_boxes[i] = OutlineBox(circles[i].center, circles[i].radius);
+		segment_boxes.resize(segments.size());
+		for (size_t j = 0; j < segments.size(); j++)
+			segment_boxes[j] = OutlineBox(segments[j].t1, segments[j].t2);
+
 		// circle - circle intersections
 		glm::dvec2 t1, t2;
 		OutlinePoint point;
@@ -218,6 +263,7 @@ struct OutlineTraverser {
 			if (circles[i].isempty()) continue;
 			for (size_t j = i + 1; j < circles.size(); j++) {
 				if (circles[j].isempty()) continue;
+				if (!circle_boxes[i].overlaps(circle_boxes[j])) continue;
 				if (!intersect_circle_circle(circles[i].center, circles[j].center, circles[i].radius, circles[j].radius, t1, t2)) continue;
 
 				point.value = t1;
@@ -255,6 +301,7 @@ struct OutlineTraverser {
 			if (circles[i].isempty()) continue;
 			for (size_t j = 0; j < segments.size(); j++) {
 				if (segments[j].indices[0] == i || segments[j].indices[1] == i) continue;
+				if (!circle_boxes[i].overlaps(segment_boxes[j])) continue;
 				//if (i == 17 && j == 0)
 				//	std::cout << " ";
 				intersect_circle_segment(circles[i].center, circles[i].radius, segments[j].t1, segments[j].t2, t1, t2, i1, i2);
@@ -296,6 +343,7 @@ struct OutlineTraverser {
 		glm::dvec2 t;
 		for (size_t i = 0; i < segments.size(); i++) {
 			for (size_t j = i + 1; j < segments.size(); j++) {
+				if (!segment_boxes[i].overlaps(segment_boxes[j])) continue;
 				if (!intersect_segment_segment(segments[i].t1, segments[i].t2, segments[j].t1, segments[j].t2, t)) continue;
 				point.value = t;
 				point.i1 = i;
@@ -485,7 +533,7 @@ struct OutlineTraverser {
 		return k;
 	}
 
-	std::vector<Outline> traverse_outline() {
+	const std::vector<Outline> & traverse_outline() {
 		size_t k, i;
 		find_starting_point(k, i);
 
@@ -553,6 +601,13 @@ struct OutlineTraverser {
 
 OutlineFinder::OutlineFinder(Model * _model) : model(_model) { }
 
+OutlineFinder::~OutlineFinder() { } ///< here, where OutlineTraverser is complete
+
+void OutlineFinder::reset_parts() {
+	parts.clear();
+	traversers.clear();
+}
+
 void OutlineFinder::print_outline(const std::vector<Outline> & outline) {
 	std::cout << "OUTLINE" << std::endl;
 	for (size_t i = 0; i < outline.size(); i++) {
@@ -680,8 +735,8 @@ void OutlineFinder::adjust_fingers_outline(std::vector<Outline> & outline) {
 	//print_outline(outline);
 }
 
-std::vector<Outline3D> OutlineFinder::find_3D_outline( const std::vector<Outline> & outline) {
-	std::vector<Outline3D> outline3D;
+void OutlineFinder::find_3D_outline(const std::vector<Outline> & outline, std::vector<Outline3D> & outline3D) {
+	outline3D.clear();
 	double z_start, z_end, alpha;
 	Outline3D o;
 	for (size_t i = 0; i < outline.size(); i++) {
@@ -707,24 +762,51 @@ std::vector<Outline3D> OutlineFinder::find_3D_outline( const std::vector<Outline
 		outline3D.push_back(o);
 	}
 	//print_outline3D(outline3D);
-	return outline3D;
+}
+
+void OutlineFinder::find_part_outline(size_t p) {
+	const std::vector<int> & block_indices = p == 0 ? model->palm_block_indices : model->fingers_block_indices[p - 1];
+	PartOutline & part = parts[p];
+	std::vector<float> & key = part.next_key;
+	key.clear();
+	for (size_t b = 0; b < block_indices.size(); b++) {
+		glm::ivec3 block = model->blocks[block_indices[b]];
+		for (int k = 0; k < block_size(block); k++) {
+			key.push_back(block[k]);
+			key.push_back(model->centers[block[k]][0]);
+			key.push_back(model->centers[block[k]][1]);
+			key.push_back(model->radii[block[k]]);
+		}
+	}
+	if (key == part.key) return;
+
+	if (!traversers[p]) traversers[p].reset(new OutlineTraverser(model, block_indices));
+	traversers[p]->find_outline_intersections();
+	const std::vector<Outline> & outline = traversers[p]->traverse_outline();
+	part.outline.assign(outline.begin(), outline.end());
+	part.key.swap(key);
 }
 
 void OutlineFinder::find_outline(){
+
+	///--- Palm and fingers are independent, each is only recomputed when its projection changed
+	int num_parts = model->fingers_block_indices.size() + 1;
+	parts.resize(num_parts);
+	traversers.resize(num_parts);
+	#pragma omp parallel for schedule(dynamic)
+	for (int p = 0; p < num_parts; p++)
+		find_part_outline(p);
+
+	///--- Stitched in buffers that keep their memory from one call to the next
+	palm_outline.assign(parts[0].outline.begin(), parts[0].outline.end());
 	
-	OutlineTraverser palm_outline_traverser(model, model->palm_block_indices);
-	palm_outline_traverser.find_outline_intersections();
-	std::vector<Outline> palm_outline = palm_outline_traverser.traverse_outline();
-	
-	std::vector<Outline> final_outline;
+	final_outline.clear();
 	int finger_index; int palm_index;
-	std::vector<std::pair<glm::dvec2, glm::dvec2>> intersections;
+	std::pair<glm::dvec2, glm::dvec2> intersections[4];
 	for (size_t f = 0; f < model->fingers_block_indices.size(); f++) {	
 		//std::cout << "f = " << f << std::endl;
 		// compute finger outline		
-		OutlineTraverser finger_outline_traverser(model, model->fingers_block_indices[f]);
-		finger_outline_traverser.find_outline_intersections();
-		std::vector<Outline> finger_outline = finger_outline_traverser.traverse_outline();		
+		finger_outline.assign(parts[f + 1].outline.begin(), parts[f + 1].outline.end());
 
 		// find common outline between palm and finger
 		finger_index = -1; palm_index = -1;
@@ -742,10 +824,10 @@ void OutlineFinder::find_outline(){
 			}
 		}
 		if (palm_index != -1 && finger_index != -1) {
-			intersections = intersect_segment_segment_same_circle(glm::dvec2(model->centers[palm_outline[palm_index].indices[0]][0], model->centers[palm_outline[palm_index].indices[0]][1]),
+			int num_intersections = intersect_segment_segment_same_circle(glm::dvec2(model->centers[palm_outline[palm_index].indices[0]][0], model->centers[palm_outline[palm_index].indices[0]][1]),
 				model->radii[palm_outline[palm_index].indices[0]], palm_outline[palm_index].start, palm_outline[palm_index].end,
-				finger_outline[finger_index].start, finger_outline[finger_index].end);
-			for (size_t k = 0; k < intersections.size(); k++) {
+				finger_outline[finger_index].start, finger_outline[finger_index].end, intersections);
+			for (int k = 0; k < num_intersections; k++) {
 				o.indices = glm::ivec2(model->fingers_base_centers[f], RAND_MAX);
 				o.start = intersections[k].first;
 				o.end = intersections[k].second;
@@ -765,7 +847,7 @@ void OutlineFinder::find_outline(){
 	//adjust_fingers_outline(final_outline);
 	//std::cout << "commented adjust outline" << std::endl;
 
-	outline3D = find_3D_outline(final_outline);
+	find_3D_outline(final_outline, outline3D);
 
 }
 
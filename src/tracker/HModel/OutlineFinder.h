@@ -1,9 +1,11 @@
 #pragma once
 #include "cudax/cuda_glm.h"
 #include <vector>
+#include <memory>
 #include <iostream>
 
 class Model;
+struct OutlineTraverser;
 
 struct Outline {
 	glm::vec2 t1;
@@ -22,11 +24,27 @@ struct Outline3D {
 };
 
 class OutlineFinder {
+	/// Outline of the palm or of a finger, on its own
+	struct PartOutline {
+		std::vector<float> key; ///< ids, projections and radii of the centers of its blocks, when the outline was computed
+		std::vector<float> next_key; ///< buffer of find_part_outline
+		std::vector<Outline> outline;
+	};
+	std::vector<PartOutline> parts; ///< palm, then Model::fingers_block_indices
+	std::vector<std::unique_ptr<OutlineTraverser>> traversers; ///< of each part, kept so that recomputing its outline does not allocate
+	std::vector<Outline> palm_outline, finger_outline, final_outline; ///< buffers of find_outline
+
+	void find_part_outline(size_t p);
+
 public:
 	std::vector<Outline3D> outline3D;
 	Model * const model;
 
 	OutlineFinder(Model * _model);
+	~OutlineFinder();
+
+	/// Forgets the outlines and traversers of the parts, to call when Model::palm_block_indices or fingers_block_indices change
+	void reset_parts();
 
 	void print_outline(const std::vector<Outline> & outline);
 
@@ -36,7 +54,7 @@ public:
 
 	void adjust_fingers_outline(std::vector<Outline> & outline);
 		
-	std::vector<Outline3D> find_3D_outline(const std::vector<Outline> & outline);
+	void find_3D_outline(const std::vector<Outline> & outline, std::vector<Outline3D> & outline3D);
 	
 	void find_outline();
 
@@ -1,6 +1,9 @@
 #include "HandFinder.h"
 
 #include <numeric> ///< std::iota
+#include <algorithm> ///< std::sort
+#include <cmath> ///< std::floor
+#include <cfloat> ///< FLT_MAX
 #include <fstream> ///< ifstream
 #include "util/mylogger.h"
 #include "util/opencv_wrapper.h"
@@ -22,6 +25,9 @@ HandFinder::HandFinder(Camera *camera) : camera(camera){
     tw_settings->tw_add(settings->show_wband, "show_wband", "group=HandFinder");
     tw_settings->tw_add(settings->wband_size, "wband_size", "group=HandFinder");
     tw_settings->tw_add(settings->depth_range, "depth_range", "group=HandFinder");
+    tw_settings->tw_add(settings->sensor_points_budget, "points_budget", "group=HandFinder");
+    tw_settings->tw_add(settings->sensor_points_voxel, "points_voxel", "group=HandFinder");
+    tw_settings->tw_add(settings->roi_padding, "roi_padding", "group=HandFinder");
 
 #ifdef TODO_TWEAK_WRISTBAND_COLOR
      // TwDefine(" Settings/classifier_hsv_min colormode=hls ");
@@ -52,67 +58,80 @@ Vector3 point_at_depth_pixel(cv::Mat& depth, int x, int y, Camera* camera) {
 	return camera->depth_to_world(x, y, z);
 }
 
+/// Looks for the wristband in region only: HSV and depth thresholds, then the biggest connected component.
+/// @return false if there is none, or if it touches a side of region inside the frame (it might continue beyond)
+bool HandFinder::find_wristband(cv::Mat& depth, cv::Mat& color, const cv::Rect& region, cv::Rect& box) {
+    ///--- Allocated once
+    static cv::Mat color_hsv;
+    static cv::Mat in_z_range;
+    static cv::Mat mask, labels, stats, centroids;
+
+    cv::cvtColor(color(region), color_hsv, CV_RGB2HSV);
+    cv::inRange(color_hsv, settings->hsv_min, settings->hsv_max, /*=*/ mask);
+    cv::inRange(depth(region), camera->zNear(), camera->zFar() /*mm*/, /*=*/ in_z_range);
+    cv::bitwise_and(mask, in_z_range, mask);
+
+    int num_components = cv::connectedComponentsWithStats(mask, labels, stats, centroids, 4 /*connectivity={4,8}*/);
+    if(num_components<2 /*not found anything beyond background*/) return false;
+
+    ///--- Biggest component beyond background
+    int wband = 1;
+    for(int i = 2; i < num_components; ++i)
+        if(stats.at<int>(i,cv::CC_STAT_AREA) > stats.at<int>(wband,cv::CC_STAT_AREA)) wband = i;
+    box = cv::Rect(region.x + stats.at<int>(wband,cv::CC_STAT_LEFT), region.y + stats.at<int>(wband,cv::CC_STAT_TOP),
+                   stats.at<int>(wband,cv::CC_STAT_WIDTH), stats.at<int>(wband,cv::CC_STAT_HEIGHT));
+
+    bool cut = (box.x == region.x && region.x > 0) || (box.y == region.y && region.y > 0) ||
+               (box.br().x == region.br().x && region.br().x < depth.cols) || (box.br().y == region.br().y && region.br().y < depth.rows);
+    if(cut) return false;
+
+    cv::Mat mask_region = mask_wristband(region);
+    cv::compare(labels, wband, mask_region, cv::CMP_EQ);
+    return true;
+}
+
+/// Pixels whose point can be within radius of center: projection of the bounding cube, the full frame if it
+/// reaches behind the camera
+cv::Rect HandFinder::sphere_box(const Vector3& center, Scalar radius) {
+    cv::Rect frame(0, 0, camera->width(), camera->height());
+    if(!(center.z() - radius > 0)) return frame;
+    Vector2 min = Vector2::Constant(FLT_MAX), max = Vector2::Constant(-FLT_MAX);
+    for(int corner = 0; corner < 8; ++corner){
+        Vector3 offset((corner & 1) ? radius : -radius, (corner & 2) ? radius : -radius, (corner & 4) ? radius : -radius);
+        Vector2 x = camera->world_to_image(center + offset);
+        min = min.cwiseMin(x);
+        max = max.cwiseMax(x);
+    }
+    ///--- Rows are flipped (see Camera::depth_to_world), 2 pixels of margin for rounding
+    int col_min = std::floor(min.x()) - 2, col_max = std::ceil(max.x()) + 2;
+    int row_min = camera->height() - 1 - std::ceil(max.y()) - 2, row_max = camera->height() - 1 - std::floor(min.y()) + 2;
+    return cv::Rect(col_min, row_min, col_max - col_min + 1, row_max - row_min + 1) & frame;
+}
+
+/// The wristband is first looked for around the hand of the last frame, the full frame is only searched
+/// once it is lost. The depth gating, the PCA point gathering and the spherical crop then only visit the
+/// pixels whose point can be within the spheres they test.
 void HandFinder::binary_classification(cv::Mat& depth, cv::Mat& color) {    
     _wristband_found = false;
 
     TIMED_SCOPE(timer, "Worker::binary_classification");
 
     ///--- Fetch from settings
-    cv::Scalar hsv_min = settings->hsv_min;
-    cv::Scalar hsv_max = settings->hsv_max;
     Scalar wband_size = _settings.wband_size;
     Scalar depth_range= _settings.depth_range;
 
-    ///--- We look for wristband up to here...
-    Scalar depth_farplane = camera->zFar();
-
     Scalar crop_radius = 150;
-
-    ///--- Allocated once
-    static cv::Mat color_hsv;
-    static cv::Mat in_z_range;
-
-    // TIMED_BLOCK(timer,"Worker_classify::(convert to HSV)")
-    {
-        cv::cvtColor(color, color_hsv, CV_RGB2HSV);
-        cv::inRange(color_hsv, hsv_min, hsv_max, /*=*/ mask_wristband);
-        cv::inRange(depth, camera->zNear(), depth_farplane /*mm*/, /*=*/ in_z_range);
-        cv::bitwise_and(mask_wristband, in_z_range, mask_wristband);
-		//cv::imshow("mask_wristband (pre)", mask_wristband); cv::waitKey(1);
-    }
+    const cv::Rect frame(0, 0, depth.cols, depth.rows);
 
     // TIMED_BLOCK(timer,"Worker_classify::(robust wrist)")
+    cv::Rect wband_box;
     {
-        cv::Mat labels, stats, centroids;
-        int num_components = cv::connectedComponentsWithStats(mask_wristband, labels, stats, centroids, 4 /*connectivity={4,8}*/);       
-
-        ///--- Generate array to sort
-        std::vector< int > to_sort(num_components);
-        std::iota(to_sort.begin(), to_sort.end(), 0 /*start from*/);       
-
-        ///--- Sort accoding to area
-        auto lambda = [stats](int i1, int i2){
-            int area1 = stats.at<int>(i1,cv::CC_STAT_AREA);
-            int area2 = stats.at<int>(i2,cv::CC_STAT_AREA);
-            return area1>area2;
-        };
-        std::sort(to_sort.begin(), to_sort.end(), lambda);
-
-        if(num_components<2 /*not found anything beyond background*/){            		
-            _has_useful_data = false;
-        }
-        else
-        {
-            if(_has_useful_data==false){
-                //std::cout << "NEW useful data => reinit" << std::endl;
-                //trivial_detector->exec(frame, sensor_silhouette);
-            }
-            _has_useful_data = true;
-            
-            ///--- Select 2nd biggest component
-            mask_wristband = (labels==to_sort[1]);
-            _wristband_found = true;
-        }
+        mask_wristband.create(depth.size(), CV_8UC1);
+        mask_wristband.setTo(0);
+        bool tracked = (roi.area() > 0) && (_settings.roi_padding >= 0);
+        _wristband_found = (tracked && find_wristband(depth, color, roi, wband_box)) || find_wristband(depth, color, frame, wband_box);
+        _has_useful_data = _wristband_found;
+        roi = cv::Rect();
     }
 
 	if (_settings.show_wband) {
@@ -122,64 +141,61 @@ void HandFinder::binary_classification(cv::Mat& depth, cv::Mat& color) {
     else
         cv::destroyWindow("show_wband");
 
-    // TIMED_BLOCK(timer,"Worker_classify::(crop at wrist depth)")
-    {
-        ///--- Extract wristband average depth
-        std::pair<float, int> avg;
-        for (int row = 0; row < mask_wristband.rows; ++row) {
-            for (int col = 0; col < mask_wristband.cols; ++col) {
-                float depth_wrist = depth.at<ushort>(row,col);
-                if(mask_wristband.at<uchar>(row,col)==255){
-                     if(camera->is_valid(depth_wrist)){
-                         avg.first += depth_wrist;
-                         avg.second++;
-                     }
-                 }
+    _wband_center = Vector3(0,0,0);
+    _wband_dir = Vector3(0,0,-1);
+
+    // TIMED_BLOCK(timer,"Worker_classify::(wristband depth and center)")
+    std::pair<float, int> avg(0.0f, 0);
+    int counter = 0;
+    for (int row = wband_box.y; row < wband_box.y + wband_box.height; ++row) {
+        const uchar* mask_row = mask_wristband.ptr<uchar>(row);
+        const ushort* depth_row = depth.ptr<ushort>(row);
+        for (int col = wband_box.x; col < wband_box.x + wband_box.width; ++col) {
+            if(mask_row[col]!=255) continue;
+            float depth_wrist = depth_row[col];
+            if(camera->is_valid(depth_wrist)){
+                avg.first += depth_wrist;
+                avg.second++;
             }
+            _wband_center += camera->depth_to_world(col, row, depth_row[col]);
+            counter++;
         }
-        ushort depth_wrist = (avg.second==0) ? camera->zNear() : avg.first / avg.second; 
-		//depth_wrist = 350;
-        ///--- First just extract pixels at the depth range of the wrist
-        cv::inRange(depth, depth_wrist-depth_range, /*mm*/
-                           depth_wrist+depth_range, /*mm*/
-                           sensor_silhouette /*=*/);
     }
+    ushort depth_wrist = (avg.second==0) ? camera->zNear() : avg.first / avg.second; 
 
-    // cv::imshow("sensor_silhouette (before)", sensor_silhouette);
+    ///--- Pixels at the depth range of the wrist (same rounding of the bounds as cv::inRange)
+    Scalar depth_min = depth_wrist-depth_range; /*mm*/
+    Scalar depth_max = depth_wrist+depth_range; /*mm*/
+    ushort in_range_min = cv::saturate_cast<ushort>(depth_min);
+    ushort in_range_max = cv::saturate_cast<ushort>(depth_max);
+    if(!_wristband_found){
+        ///--- Nothing to crop around
+        cv::inRange(depth, depth_min, depth_max, sensor_silhouette /*=*/);
+        return;
+    }
+    _wband_center /= counter;
+    bool missing_depth_in_range = (in_range_min == 0); ///< then the points of the missing pixels, at the origin, can be anywhere in the image
 
-    _wband_center = Vector3(0,0,0);
-    _wband_dir = Vector3(0,0,-1);
     // TIMED_BLOCK(timer,"Worker_classify::(PCA)")
     {
-        ///--- Compute MEAN
-        int counter = 0;
-        for (int row = 0; row < mask_wristband.rows; ++row){
-            for (int col = 0; col < mask_wristband.cols; ++col){
-                if(mask_wristband.at<uchar>(row,col)!=255) continue;
-				_wband_center += point_at_depth_pixel(depth, col, row, camera);
-                counter ++;
-            }
-        }
-        _wband_center /= counter;
-        std::vector<Vector3> pts; pts.push_back(_wband_center);
-
-        ///--- Compute Covariance
+        ///--- Gather the points near the wristband
         static std::vector<Vector3> points_pca;
         points_pca.reserve(100000);
         points_pca.clear();		
-        for (int row = 0; row < sensor_silhouette.rows; ++row){
-            for (int col = 0; col < sensor_silhouette.cols; ++col){
-                if(sensor_silhouette.at<uchar>(row,col)!=255) continue;
-				Vector3 p_pixel = point_at_depth_pixel(depth, col, row, camera);
-                if((p_pixel-_wband_center).norm()<100){
-                    // sensor_silhouette.at<uchar>(row,col) = 255;
+        cv::Rect box = missing_depth_in_range ? frame : sphere_box(_wband_center, 100);
+        for (int row = box.y; row < box.y + box.height; ++row){
+            const ushort* depth_row = depth.ptr<ushort>(row);
+            for (int col = box.x; col < box.x + box.width; ++col){
+                if(depth_row[col] < in_range_min || depth_row[col] > in_range_max) continue;
+                Vector3 p_pixel = camera->depth_to_world(col, row, depth_row[col]);
+                if((p_pixel-_wband_center).norm()<100)
                     points_pca.push_back(p_pixel);
-                } else {
-                    // sensor_silhouette.at<uchar>(row,col) = 0;
-                }
             }
         }
-        if (points_pca.size() == 0) return;
+        if (points_pca.size() == 0){
+            cv::inRange(depth, depth_min, depth_max, sensor_silhouette /*=*/);
+            return;
+        }
         ///--- Compute PCA
         Eigen::Map<Matrix_3xN> points_mat(points_pca[0].data(), 3, points_pca.size() );       
         for(int i : {0,1,2})
@@ -199,17 +215,28 @@ void HandFinder::binary_classification(cv::Mat& depth, cv::Mat& color) {
         Vector3 crop_center = _wband_center + _wband_dir*( crop_radius - wband_size /*mm*/);
 		//Vector3 crop_center = _wband_center + _wband_dir*( crop_radius + wband_size /*mm*/);
 
-        for (int row = 0; row < sensor_silhouette.rows; ++row){
-            for (int col = 0; col < sensor_silhouette.cols; ++col){
-                if(sensor_silhouette.at<uchar>(row,col)!=255) continue;
-
-				Vector3 p_pixel = point_at_depth_pixel(depth, col, row, camera);
-                if((p_pixel-crop_center).squaredNorm() < crop_radius_sq)
-                    sensor_silhouette.at<uchar>(row,col) = 255;
-                else
-                    sensor_silhouette.at<uchar>(row,col) = 0;
+        sensor_silhouette.create(depth.size(), CV_8UC1);
+        sensor_silhouette.setTo(0);
+        cv::Rect box = missing_depth_in_range ? frame : sphere_box(crop_center, crop_radius);
+        int col_min = wband_box.x, col_max = wband_box.br().x - 1;
+        int row_min = wband_box.y, row_max = wband_box.br().y - 1;
+        for (int row = box.y; row < box.y + box.height; ++row){
+            const ushort* depth_row = depth.ptr<ushort>(row);
+            uchar* silhouette_row = sensor_silhouette.ptr<uchar>(row);
+            for (int col = box.x; col < box.x + box.width; ++col){
+                if(depth_row[col] < in_range_min || depth_row[col] > in_range_max) continue;
+                Vector3 p_pixel = camera->depth_to_world(col, row, depth_row[col]);
+                if((p_pixel-crop_center).squaredNorm() < crop_radius_sq){
+                    silhouette_row[col] = 255;
+                    col_min = std::min(col_min, col); col_max = std::max(col_max, col);
+                    row_min = std::min(row_min, row); row_max = std::max(row_max, row);
+                }
             }
         }
+
+        ///--- Where to look for the wristband next frame
+        int padding = _settings.roi_padding;
+        roi = cv::Rect(col_min - padding, row_min - padding, col_max - col_min + 1 + 2*padding, row_max - row_min + 1 + 2*padding) & frame;
     }
 
     if(_settings.show_hand){
@@ -219,3 +246,50 @@ void HandFinder::binary_classification(cv::Mat& depth, cv::Mat& color) {
     }
 }
 
+/// Fills sensor_indicator with the silhouette pixels used as 3D constraints. Pixels are binned
+/// on a voxel grid and only the one closest to each voxel center is kept, so that the density
+/// is even across palm and fingers regardless of the distance to the camera. If there are
+/// still more than sensor_points_budget voxels, a regular stride over them is kept.
+void HandFinder::compute_sensor_indicator(cv::Mat& depth) {
+    TIMED_SCOPE(timer, "HandFinder::compute_sensor_indicator");
+    const Scalar voxel = _settings.sensor_points_voxel;
+    const int width = camera->width();
+
+    ///--- Bin silhouette pixels
+    sensor_samples.clear();
+    for (int row = 0; row < sensor_silhouette.rows; ++row) {
+        for (int col = 0; col < sensor_silhouette.cols; ++col) {
+            if (sensor_silhouette.at<uchar>(row, col) != 255) continue;
+            SensorSample sample;
+            sample.index = row * width + col;
+            if (voxel > 0) {
+                Vector3 p = point_at_depth_pixel(depth, col, row, camera) / voxel;
+                Vector3 v(std::floor(p[0]), std::floor(p[1]), std::floor(p[2]));
+                const long long offset = 1 << 20, bits = 21; ///< voxel coordinates are within +-2^20
+                sample.voxel = (((long long) v[0] + offset) << (2 * bits)) | (((long long) v[1] + offset) << bits) | ((long long) v[2] + offset);
+                sample.distance = (p - v - Vector3::Constant(0.5)).squaredNorm();
+            } else {
+                sample.voxel = sample.index;
+                sample.distance = 0;
+            }
+            sensor_samples.push_back(sample);
+        }
+    }
+
+    ///--- Keep the sample closest to the center of each voxel
+    std::sort(sensor_samples.begin(), sensor_samples.end());
+    int num_voxels = 0;
+    for (size_t i = 0; i < sensor_samples.size(); ++i)
+        if (i == 0 || sensor_samples[i].voxel != sensor_samples[i - 1].voxel)
+            sensor_samples[num_voxels++] = sensor_samples[i];
+
+    ///--- Stratified selection within the budget
+    int budget = std::min(num_voxels, upper_bound_num_sensor_points);
+    if (_settings.sensor_points_budget > 0) budget = std::min(budget, _settings.sensor_points_budget);
+    for (int k = 0; k < budget; ++k)
+        sensor_indicator[k] = sensor_samples[(long long) k * num_voxels / budget].index;
+    num_sensor_points = budget;
+
+    ///--- Back to scanline order (coherent depth fetches)
+    std::sort(sensor_indicator, sensor_indicator + num_sensor_points);
+}
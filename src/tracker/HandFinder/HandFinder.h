@@ -3,6 +3,7 @@
 #include "tracker/Types.h"
 #include "util/opencv_wrapper.h"
 #include "tracker/Detection/TrivialDetector.h"
+#include <vector>
 
 class HandFinder{
 private:
@@ -21,6 +22,9 @@ public:
         bool show_wband = false;
         float depth_range = 150;
         float wband_size = 30;
+        int sensor_points_budget = 3000; ///< max number of sensor_indicator entries per frame (<=0 for no limit)
+        float sensor_points_voxel = 4; ///< mm, one sensor point is kept per voxel (<=0 to keep every pixel)
+        int roi_padding = 40; ///< pixels around the last hand and wristband where the wristband is searched first (<0 to always search the full frame)
         cv::Scalar hsv_min = cv::Scalar( 94, 111,  37); ///< potentially read from file
         cv::Scalar hsv_max = cv::Scalar(120, 255, 255); ///< potentially read from file
     } _settings;
@@ -37,6 +41,22 @@ public:
 	cv::Mat mask_wristband; ///< created by binary_classifier, not used anywhere else
 	int * sensor_indicator;
 	int num_sensor_points;
+private:
+	struct SensorSample {
+		long long voxel;
+		float distance; ///< to the voxel center
+		int index; ///< row*width+col
+		bool operator<(const SensorSample& other) const {
+			if (voxel != other.voxel) return voxel < other.voxel;
+			if (distance != other.distance) return distance < other.distance;
+			return index < other.index;
+		}
+	};
+	std::vector<SensorSample> sensor_samples; ///< buffer of compute_sensor_indicator
+	cv::Rect roi; ///< hand and wristband of the last frame, padded (empty when they were lost)
+
+	bool find_wristband(cv::Mat& depth, cv::Mat& color, const cv::Rect& region, cv::Rect& box);
+	cv::Rect sphere_box(const Vector3& center, Scalar radius);
 
 public:
     bool has_useful_data(){ return _has_useful_data; }
@@ -46,4 +66,5 @@ public:
     void wristband_direction_flip(){ _wband_dir=-_wband_dir; }
 public:
 	void binary_classification(cv::Mat& depth, cv::Mat& color);
+	void compute_sensor_indicator(cv::Mat& depth);
 };
@@ -125,16 +125,7 @@ public:
 	//			hand_segmentation(worker->current_frame.depth, worker->current_frame.color,
 		//			worker->handfinder->sensor_silhouette);
 				//cv::imshow("sensor_silhouette", worker->handfinder->sensor_silhouette); cv::waitKey(3);
-				worker->handfinder->num_sensor_points = 0; int count = 0;
-				for (int row = 0; row < worker->handfinder->sensor_silhouette.rows; ++row) {
-					for (int col = 0; col < worker->handfinder->sensor_silhouette.cols; ++col) {
-						if (worker->handfinder->sensor_silhouette.at<uchar>(row, col) != 255) continue;
-						if (count % 2 == 0) {
-							worker->handfinder->sensor_indicator[worker->handfinder->num_sensor_points] = row * worker->camera->width() + col;
-							worker->handfinder->num_sensor_points++;
-						}
-					}
-				}
+				worker->handfinder->compute_sensor_indicator(worker->current_frame.depth);
 
 				if (current_frame == 1) {
 					Vector3 translation = worker->trivial_detector->exec(worker->current_frame, worker->handfinder->sensor_silhouette);
@@ -158,16 +149,7 @@ public:
 			worker->handfinder->binary_classification(worker->current_frame.depth, worker->current_frame.color);
 
 				//cv::imshow("sensor_silhouette", worker->handfinder->sensor_silhouette); cv::waitKey(3);
-				worker->handfinder->num_sensor_points = 0; int count = 0;
-				for (int row = 0; row < worker->handfinder->sensor_silhouette.rows; ++row) {
-					for (int col = 0; col < worker->handfinder->sensor_silhouette.cols; ++col) {
-						if (worker->handfinder->sensor_silhouette.at<uchar>(row, col) != 255) continue;
-						if (count % 2 == 0) {
-							worker->handfinder->sensor_indicator[worker->handfinder->num_sensor_points] = row * worker->camera->width() + col;
-							worker->handfinder->num_sensor_points++;
-						}
-					}
-				}
+				worker->handfinder->compute_sensor_indicator(worker->current_frame.depth);
 
 				if (current_frame == 1) {
 					Vector3 translation = worker->trivial_detector->exec(worker->current_frame, worker->handfinder->sensor_silhouette);
@@ -234,6 +216,10 @@ public:
 				if (tracking_error_file.is_open()) {
 					tracking_error_file << worker->tracking_error.pull_error << " " << worker->tracking_error.push_error << endl;
 				}
+				static ofstream tracking_statistics_file(data_path + "hmodel_tracking_statistics.txt");
+				if (tracking_statistics_file.is_open()) {
+					tracking_statistics_file << worker->tracking_statistics.num_iters << " " << worker->tracking_statistics.time << endl;
+				}
 				static ofstream solutions_file(solutions_filename);
 				if (solutions_file.is_open()) {
 					solutions_file << solutions->frames[frame_offset].transpose() << endl;
@@ -334,7 +320,7 @@ public:
 			filename = fitting_path + stringstream.str() + "/mask.png";
 			cv::imwrite(filename, worker->handfinder->sensor_silhouette);
 			// Write model
-			worker->model->write_model(fitting_path + stringstream.str() + "/");
+			worker->model->write_model_bundle(fitting_path + stringstream.str() + "/model.hmb");
 			}
 			}*/
 		}
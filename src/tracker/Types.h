@@ -33,6 +33,7 @@ const int num_thetas_thumb = 4;
 const int num_thetas_fingers = 16;
 const int num_thetas_pose = 20;
 const int num_fingers = 5;
+const int num_thetas_finger = 4; ///< each finger has a contiguous block of dofs after num_thetas_ignore: thumb, index, middle, ring, pinky
 const int num_joints = 21;
 const int num_temporal = 37;
 const int num_phalanges = 17;
@@ -42,11 +43,20 @@ const int upper_bound_num_rendered_outline_points = 5000;
 
 typedef Eigen::Matrix<Scalar, num_thetas, 1> Thetas;
 
+/// The linear system of the tracking loop has the num_thetas parameters, extended by
+/// the latent variables of PoseSpace. Its storage has a compile-time upper bound so
+/// that systems and their temporaries never go to the heap.
+const int num_thetas_latent_max = num_thetas_pose;
+const int num_system_max = num_thetas + num_thetas_latent_max;
+typedef Eigen::Matrix<Scalar, Eigen::Dynamic, Eigen::Dynamic, Eigen::ColMajor, num_system_max, num_system_max> Matrix_System;
+typedef Eigen::Matrix<Scalar, Eigen::Dynamic, 1, Eigen::ColMajor, num_system_max, 1> Vector_System;
+
 /// More complex matrixes
 typedef Eigen::Matrix<Scalar, 2, 3> Matrix_2x3;
 typedef Eigen::Matrix<Scalar, 1, Eigen::Dynamic> Matrix_1xN;
 typedef Eigen::Matrix<Scalar, 2, Eigen::Dynamic> Matrix_2xN;
 typedef Eigen::Matrix<Scalar, 3, Eigen::Dynamic> Matrix_3xN;
+typedef Eigen::Matrix<Scalar, 3, num_thetas> Matrix_3xTheta;
 typedef Eigen::Matrix<Scalar, Eigen::Dynamic, 2> Matrix_Nx2;
 typedef Eigen::Matrix<Scalar, Eigen::Dynamic, Eigen::Dynamic> Matrix_MxN;
 
@@ -63,12 +73,12 @@ inline Real inf(){ return std::numeric_limits<Real>::max(); }
 
 /// Linear system lhs*x=rhs
 struct LinearSystem {
-    Matrix_MxN lhs; // J^T*J
-	VectorN rhs; // J^T*r
+    Matrix_System lhs; // J^T*J
+	Vector_System rhs; // J^T*r
     LinearSystem() {}
     LinearSystem(int n) {
-        lhs = Matrix_MxN::Zero(n,n);
-        rhs = VectorN::Zero(n);
+        lhs = Matrix_System::Zero(n,n);
+        rhs = Vector_System::Zero(n);
 	}
 };
 
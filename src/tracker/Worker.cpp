@@ -15,6 +15,11 @@
 #include "tracker/HModel/Model.h"
 
 #include <ctime>
+#include <limits>
+#include <algorithm>
+#ifdef _OPENMP
+#include <omp.h>
+#endif
 
 void Worker::updateGL() { if (glarea != NULL) glarea->updateGL(); }
 
@@ -37,6 +42,9 @@ Worker::Worker(Camera *camera, bool test, bool benchmark, bool save_rasotrized_m
 	model->compute_outline();
 
 	if (user_name == 0) model->manually_adjust_initial_transformations();
+
+	thetas.resize(num_thetas);
+	delta_thetas_buffer.resize(num_thetas);
 }
 
 /// @note any initialization that has to be done once GL context is active
@@ -48,6 +56,11 @@ void Worker::init_graphic_resources() {
 
 	tw_settings->tw_add(settings->termination_max_iters, "#iters", "group=Tracker");
 	tw_settings->tw_add(settings->termination_max_rigid_iters, "#iters (rigid)", "group=Tracker");
+	tw_settings->tw_add(settings->termination_min_iters, "#iters (min)", "group=Tracker");
+	tw_settings->tw_add(settings->termination_min_update, "min |dtheta|", "group=Tracker");
+	tw_settings->tw_add(settings->termination_min_decrease, "min decrease", "group=Tracker");
+	tw_settings->tw_add(settings->termination_max_time, "max time (ms)", "group=Tracker");
+	tw_settings->tw_add(settings->termination_min_finger_update, "min |dtheta| (finger)", "group=Tracker");
 
 	///--- Initialize the energies modules
 	using namespace energy;
@@ -75,20 +88,47 @@ Worker::~Worker() {
 }
 
 bool Worker::track_till_convergence() {
-	
-	for (int i = 0; i < settings->termination_max_iters; ++i) {
-		track(i);
+	QElapsedTimer timer;
+	timer.start();
+
+	///--- The errors are needed at every iteration if we might stop early
+	bool early_termination = settings->termination_min_update > 0 || settings->termination_min_decrease > 0 || settings->termination_max_time > 0;
+	float last_error = std::numeric_limits<float>::max();
+
+	tracking_statistics.converged = false;
+	int i = 0;
+	while (i < settings->termination_max_iters) {
+		bool eval_error = early_termination || E_damping.settings->lm_enable || (i == settings->termination_max_iters - 1);
+		float update = track(i, eval_error);
 		//tracking_error_optimization[i] = tracking_error;
+		i++;
+
+		float error = tracking_error.pull_error + tracking_error.push_error;
+		bool small_update = update < settings->termination_min_update;
+		bool small_decrease = settings->termination_min_decrease > 0 && last_error - error < settings->termination_min_decrease * last_error;
+		bool out_of_time = settings->termination_max_time > 0 && timer.elapsed() > settings->termination_max_time;
+		last_error = error;
+
+		if (i < std::max(settings->termination_min_iters, settings->termination_max_rigid_iters + 1)) continue;
+		if (i == settings->termination_max_iters) break;
+		if (small_update || small_decrease || out_of_time) {
+			tracking_statistics.converged = !out_of_time;
+			break;
+		}
 	}
-	
+	tracking_statistics.num_iters = i;
+	tracking_statistics.time = timer.elapsed();
+
 	return monitor.is_failure_frame(tracking_error.pull_error, tracking_error.push_error, E_fitting.settings->fit2D_enable);
 }
 
-void Worker::track(int iter) {
-	bool eval_error = (iter == settings->termination_max_iters - 1);
+/// @return norm of the update
+float Worker::track(int iter, bool eval_error) {
 	bool rigid_only = (iter < settings->termination_max_rigid_iters);
+	if (iter == 0) std::fill(frozen_fingers, frozen_fingers + num_fingers, false);
 
-	std::vector<float> _thetas = model->get_theta();
+	std::vector<float> & _thetas = thetas;
+	_thetas.assign(model->get_theta().begin(), model->get_theta().end()); ///< same size every iteration, no reallocation
 
 	///--- Serialize matrices for jacobian computation
 	model->serializer.serialize_model();
@@ -96,11 +136,38 @@ void Worker::track(int iter) {
 
 	///--- Optimization phases	
 	LinearSystem system(num_thetas);
+	LinearSystem system_collision(num_thetas);
+	LinearSystem system_temporal(num_thetas);
+	LinearSystem system_limits(num_thetas);
+
+	///--- Pose-only energies run on their own thread concurrently with the fitting, each into its own system
+	auto pose_energies = [&] {
+		E_collision.track(system_collision);
+		E_temporal.update_positions(current_frame);
+		E_temporal.track(system_temporal, current_frame);
+		E_limits.track(system_limits, _thetas);
+	};
+	pose_thread.start(pose_energies);
+
+	///--- The fitting leaves that core to the pose-only energies
+#ifdef _OPENMP
+	int num_threads = omp_get_max_threads();
+	omp_set_num_threads(std::max(num_threads - 1, 1));
+#endif
 	//eval_error = true;
 	E_fitting.track(current_frame, system, rigid_only, eval_error, tracking_error.push_error, tracking_error.pull_error, iter); ///<!!! MUST BE FIRST CALL		
-	E_collision.track(system);
-	E_temporal.track(system, current_frame);
-	E_limits.track(system, _thetas);
+#ifdef _OPENMP
+	omp_set_num_threads(num_threads);
+#endif
+	pose_thread.wait();
+
+	///--- Sum in a fixed order
+	system.lhs += system_collision.lhs; system.rhs += system_collision.rhs;
+	system.lhs += system_temporal.lhs; system.rhs += system_temporal.rhs;
+	system.lhs += system_limits.lhs; system.rhs += system_limits.rhs;
+
+	if (E_damping.settings->lm_enable)
+		E_damping.update(iter, tracking_error.pull_error + tracking_error.push_error);
 	E_damping.track(system);
 	if (rigid_only) 
 		energy::Energy::rigid_only(system);
@@ -108,13 +175,23 @@ void Worker::track(int iter) {
 		E_pose.track(system, _thetas); ///<!!! MUST BE LAST CALL	
 
 	///--- Solve 
-	VectorN delta_thetas = energy::Energy::solve(system);	
+	Thetas delta_thetas = rigid_only ? energy::Energy::solve(system) : energy::Energy::solve_fingers(system, frozen_fingers);
+
+	if (!rigid_only && settings->termination_min_finger_update > 0 && iter + 1 >= settings->termination_min_iters) {
+		for (int k = 0; k < num_fingers; ++k) {
+			int start = num_thetas_ignore + k * num_thetas_finger;
+			if (delta_thetas.segment(start, num_thetas_finger).norm() < settings->termination_min_finger_update)
+				frozen_fingers[k] = true;
+		}
+	}
 
 	///--- Update
-	const vector<float> dt(delta_thetas.data(), delta_thetas.data() + num_thetas);
-	_thetas = model->get_updated_parameters(_thetas, dt);
+	std::copy(delta_thetas.data(), delta_thetas.data() + num_thetas, delta_thetas_buffer.begin());
+	model->get_updated_parameters(_thetas, delta_thetas_buffer, _thetas);
 	model->move(_thetas);
 	model->update_centers();
 	model->compute_outline();
 	E_temporal.update(current_frame.id, _thetas);
+
+	return delta_thetas.norm();
 }
@@ -11,6 +11,7 @@
 #include "Energy/Fitting.h"
 #include "Energy/Fitting/TrackingMonitor.h"
 #include "Energy/Temporal.h"
+#include "util/TaskThread.h"
 
 #include "opencv2/core/core.hpp"       ///< cv::Mat
 #include "opencv2/highgui/highgui.hpp" ///< cv::imShow
@@ -22,6 +23,11 @@ public:
 	struct Settings {
 		int termination_max_iters = 6;
 		int termination_max_rigid_iters = 1;
+		int termination_min_iters = 2; ///< criteria below only apply after these iterations
+		float termination_min_update = 1e-3f; ///< stop when |delta_thetas| is below (0 to disable)
+		float termination_min_decrease = 0; ///< stop when the fitting error decreases by less than this fraction (0 to disable)
+		float termination_max_time = 0; ///< per frame budget in ms (0 to disable)
+		float termination_min_finger_update = 0; ///< stop updating a finger for the rest of the frame when the norm of its update is below (0 to disable)
 	} _settings;
 	Settings*const settings = &_settings;
 
@@ -44,6 +50,14 @@ public:
 	TrackingError tracking_error;
 	//std::vector<TrackingError> tracking_error_optimization;
 
+	/// Filled by track_till_convergence
+	struct TrackingStatistics {
+		int num_iters = 0;
+		float time = 0; ///< ms
+		bool converged = false; ///< stopped before termination_max_iters
+	} tracking_statistics;
+	bool frozen_fingers[num_fingers]; ///< converged during the current frame, see Settings::termination_min_finger_update
+
 	DepthTexture16UC1* sensor_depth_texture = NULL;
 	ColorTexture8UC3* sensor_color_texture = NULL;
 
@@ -59,6 +73,9 @@ public:
 	OffscreenRenderer offscreen_renderer;
 	OffscreenRenderer rastorizer;
 	TrackingMonitor monitor;
+	TaskThread pose_thread; ///< runs the pose-only energies next to the fitting, see track
+	std::vector<float> thetas; ///< of the current iteration, buffers of track so that it does not allocate
+	std::vector<float> delta_thetas_buffer;
 
 public:
 	Worker(Camera *camera, bool test, bool benchmark, bool save_rasotrized_model, int user_name, string data_path);
@@ -67,6 +84,6 @@ public:
 	void cleanup_graphic_resources();
 
 public:
-	void track(int iter);
+	float track(int iter, bool eval_error);
 	bool track_till_convergence();
 };
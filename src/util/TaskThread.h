@@ -0,0 +1,61 @@
+#pragma once
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+
+/// Persistent thread running one job at a time next to the calling thread, so that no thread is created per
+/// job (std::async does on libstdc++) and no memory is allocated (the job is not copied)
+/// @note the job must stay alive until wait() returns
+class TaskThread {
+	std::thread thread;
+	std::mutex mutex;
+	std::condition_variable condition;
+	void(*function)(void *) = NULL;
+	void * job = NULL;
+	bool pending = false;
+	bool quit = false;
+
+	template<class Job> static void call(void * job) { (*(Job *)job)(); }
+
+	void run() {
+		std::unique_lock<std::mutex> lock(mutex);
+		while (true) {
+			condition.wait(lock, [this] { return pending || quit; });
+			if (quit) return;
+			lock.unlock();
+			function(job);
+			lock.lock();
+			pending = false;
+			condition.notify_all();
+		}
+	}
+
+	TaskThread(const TaskThread &); ///< owns the thread, not copyable
+	TaskThread & operator=(const TaskThread &);
+
+public:
+	TaskThread() { thread = std::thread(&TaskThread::run, this); }
+	~TaskThread() {
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			quit = true;
+		}
+		condition.notify_all();
+		thread.join();
+	}
+
+	/// Runs job() on the thread, waits for the previous job first
+	template<class Job> void start(Job & job) {
+		std::unique_lock<std::mutex> lock(mutex);
+		condition.wait(lock, [this] { return !pending; });
+		this->function = &call<Job>;
+		this->job = &job;
+		pending = true;
+		condition.notify_all();
+	}
+
+	void wait() {
+		std::unique_lock<std::mutex> lock(mutex);
+		condition.wait(lock, [this] { return !pending; });
+	}
+};